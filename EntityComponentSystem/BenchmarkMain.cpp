@@ -0,0 +1,55 @@
+// Standalone benchmark driver. Builds on its own with e.g.
+//   g++ -std=c++14 -O3 -DNDEBUG -I. BenchmarkMain.cpp jsoncpp.cpp -o ecs_bench
+//
+// Usage: ecs_bench [--min=N] [--max=N] [--min-time=SECONDS] [--filter=TEXT] [--json=PATH]
+// Entity counts step by 10x from --min (default 1000) to --max (default 10000000).
+
+#include <cstdlib>
+#include <cstring>
+#include "ECSBenchmarks.h"
+
+namespace {
+	bool ParseOption(const char* arg, const char* name, std::string& value) {
+		std::size_t length = std::strlen(name);
+		if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+			value = arg + length + 1;
+			return true;
+		}
+		return false;
+	}
+}
+
+int main(int argc, char** argv) {
+	ecs::bench::BenchmarkOptions options;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string value;
+		if (ParseOption(argv[i], "--min", value)) {
+			options.minEntities = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--max", value)) {
+			options.maxEntities = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--min-time", value)) {
+			options.minTime = std::atof(value.c_str());
+		}
+		else if (ParseOption(argv[i], "--filter", value)) {
+			options.filter = value;
+		}
+		else if (ParseOption(argv[i], "--json", value)) {
+			options.jsonPath = value;
+		}
+		else {
+			std::cerr << "Unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.minEntities == 0 || options.minEntities > options.maxEntities) {
+		std::cerr << "Invalid entity range" << std::endl;
+		return 1;
+	}
+
+	ecs::bench::RunBenchmarks(options);
+	return 0;
+}
\ No newline at end of file
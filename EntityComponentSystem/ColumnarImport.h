@@ -0,0 +1,528 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <stdexcept>
+#include "json/json.h"
+#include "TEntitySystem.h"
+
+namespace ecs {
+	// Describes the fields of a component for columnar import. Specialize
+	// with a Get() returning a tuple of Field() entries, e.g.
+	//
+	//	template <> struct ComponentFields<PositionComponent> {
+	//		static constexpr bool Described = true;
+	//		static auto Get() {
+	//			return std::make_tuple(Field("x", &PositionComponent::x), ...);
+	//		}
+	//	};
+	//
+	// Components without a specialization cannot be imported from columns.
+	// A description that covers every piece of state the component has may
+	// also declare
+	//
+	//		static constexpr bool Complete = true;
+	//
+	// which lets the prototype cache store the component by its fields.
+
+	template <typename TComponent, typename TMember>
+	struct TField {
+		const char* name;
+		TMember TComponent::* member;
+	};
+
+	template <typename TComponent, typename TMember>
+	TField<TComponent, TMember> Field(const char* name, TMember TComponent::* member) {
+		static_assert(std::is_arithmetic<TMember>::value, "Only arithmetic fields can be imported from columns");
+		return TField<TComponent, TMember>{ name, member };
+	}
+
+	template <typename TComponent>
+	struct ComponentFields {
+		static constexpr bool Described = false;
+		static constexpr bool Complete = false;
+		static std::tuple<> Get() { return std::tuple<>(); }
+	};
+
+	// Whether ComponentFields<TComponent> opts in with Complete
+	template <typename TComponent, typename = void>
+	struct FieldsComplete : std::false_type {};
+
+	template <typename TComponent>
+	struct FieldsComplete<TComponent, std::enable_if_t<ComponentFields<TComponent>::Complete>> : std::true_type {};
+
+	enum class ColumnType : std::uint8_t {
+		Float32, Float64, Int32, UInt32, Int64, UInt64
+	};
+
+	inline std::size_t ColumnTypeSize(ColumnType type) noexcept {
+		switch (type) {
+		case ColumnType::Float32: case ColumnType::Int32: case ColumnType::UInt32: return 4;
+		default: return 8;
+		}
+	}
+
+	// One field of one component for every row, stored as raw values
+	struct ColumnData {
+		std::string name;
+		ColumnType type{ ColumnType::Float64 };
+		std::vector<char> bytes;
+
+		std::size_t Size() const noexcept {
+			return bytes.size() / ColumnTypeSize(type);
+		}
+
+		template <typename T>
+		void Append(T value) {
+			std::size_t offset = bytes.size();
+			bytes.resize(offset + sizeof(T));
+			std::memcpy(bytes.data() + offset, &value, sizeof(T));
+		}
+
+		// Converts the whole column to T in one pass
+		template <typename T>
+		void CopyTo(std::vector<T>& out) const {
+			out.resize(Size());
+			switch (type) {
+			case ColumnType::Float32: convert<float>(out); break;
+			case ColumnType::Float64: convert<double>(out); break;
+			case ColumnType::Int32: convert<std::int32_t>(out); break;
+			case ColumnType::UInt32: convert<std::uint32_t>(out); break;
+			case ColumnType::Int64: convert<std::int64_t>(out); break;
+			case ColumnType::UInt64: convert<std::uint64_t>(out); break;
+			}
+		}
+
+	private:
+		template <typename TSource, typename T>
+		void convert(std::vector<T>& out) const {
+			const char* data = bytes.data();
+			for (std::size_t i = 0; i < out.size(); ++i) {
+				TSource value;
+				std::memcpy(&value, data + i * sizeof(TSource), sizeof(TSource));
+				out[i] = static_cast<T>(value);
+			}
+		}
+	};
+
+	// Columns of one component type. Without rows the component is given
+	// for every entity of the batch; otherwise rows lists the batch
+	// entities owning it, in column order.
+	struct ColumnarComponent {
+		std::string name;
+		bool hasRows{ false };
+		std::vector<std::uint64_t> rows;
+		std::vector<ColumnData> columns;
+	};
+
+	struct ColumnarBatch {
+		std::size_t count{ 0 };
+		std::vector<ColumnarComponent> components;
+	};
+
+	struct ColumnarImportReport {
+		std::size_t entities{ 0 };
+		std::size_t components{ 0 };
+		std::vector<std::string> errors;
+		std::vector<std::string> warnings;
+
+		bool Ok() const noexcept {
+			return errors.empty();
+		}
+	};
+
+	namespace EntityParser {
+
+		// Reads a batch laid out as
+		//
+		//	{ "count": N, "components": {
+		//		"positionComponent": { "x": [...], "y": [...], "z": [...] },
+		//		"healthComponent": { "rows": [0, 5, ...], "health": [...] } } }
+		//
+		// Integral columns are stored as Int64, or UInt64 when a value only
+		// fits that; others as Float64.
+		inline bool ParseColumns(const Json::Value& root, ColumnarBatch& batch, ColumnarImportReport& report) {
+			if (!root.isObject() || !root["count"].isIntegral() || !root["components"].isObject()) {
+				report.errors.push_back("batch needs an integral \"count\" and a \"components\" object");
+				return false;
+			}
+
+			batch.count = root["count"].asLargestUInt();
+			batch.components.clear();
+
+			const Json::Value& components = root["components"];
+			for (const std::string& componentName : components.getMemberNames()) {
+				const Json::Value& fields = components[componentName];
+				if (!fields.isObject()) {
+					report.errors.push_back(componentName + ": expected an object of columns");
+					continue;
+				}
+
+				ColumnarComponent component;
+				component.name = componentName;
+				for (const std::string& fieldName : fields.getMemberNames()) {
+					const Json::Value& values = fields[fieldName];
+					if (!values.isArray()) {
+						report.errors.push_back(componentName + "." + fieldName + ": expected an array");
+						continue;
+					}
+
+					bool numeric = true, signed64 = true, unsigned64 = true;
+					for (Json::ArrayIndex i = 0; i < values.size() && numeric; ++i) {
+						if (!values[i].isNumeric()) {
+							report.errors.push_back(componentName + "." + fieldName + "[" + std::to_string(i) + "]: not a number");
+							numeric = false;
+						}
+						signed64 = signed64 && values[i].isInt64();
+						unsigned64 = unsigned64 && values[i].isUInt64();
+					}
+					if (!numeric) continue;
+
+					if (fieldName == "rows") {
+						component.hasRows = true;
+						component.rows.reserve(values.size());
+						for (Json::ArrayIndex i = 0; i < values.size(); ++i) {
+							if (!values[i].isUInt64()) {
+								report.errors.push_back(componentName + ".rows[" + std::to_string(i) + "]: not a row index");
+								break;
+							}
+							component.rows.push_back(values[i].asLargestUInt());
+						}
+						continue;
+					}
+
+					ColumnData column;
+					column.name = fieldName;
+					column.type = signed64 ? ColumnType::Int64 : unsigned64 ? ColumnType::UInt64 : ColumnType::Float64;
+					column.bytes.reserve(values.size() * 8);
+					for (Json::ArrayIndex i = 0; i < values.size(); ++i) {
+						if (signed64) {
+							column.Append<std::int64_t>(values[i].asLargestInt());
+						}
+						else if (unsigned64) {
+							column.Append<std::uint64_t>(values[i].asLargestUInt());
+						}
+						else {
+							column.Append<double>(values[i].asDouble());
+						}
+					}
+					component.columns.push_back(std::move(column));
+				}
+				batch.components.push_back(std::move(component));
+			}
+
+			return report.Ok();
+		}
+
+		// Binary batch layout, native byte order:
+		//	"ECSC", u32 version, u64 count, u32 componentCount, then per component
+		//	u32 nameLength, name, u64 rowCount, u8 hasRows, [u64 rows...],
+		//	u32 columnCount, then per column u32 nameLength, name, u8 type, values
+		static const char ColumnarMagic[4] = { 'E', 'C', 'S', 'C' };
+		static const std::uint32_t ColumnarVersion = 1;
+
+		namespace detail {
+			template <typename T>
+			void writePod(std::ostream& out, const T& value) {
+				out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+
+			inline void writeString(std::ostream& out, const std::string& value) {
+				writePod(out, std::uint32_t(value.size()));
+				out.write(value.data(), value.size());
+			}
+
+			template <typename T>
+			bool readPod(std::istream& in, T& value) {
+				return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+			}
+
+			// Bytes left in the stream, or the largest value when the stream
+			// cannot seek to tell
+			inline std::uint64_t remainingBytes(std::istream& in) {
+				const std::istream::pos_type unknown(-1);
+				std::istream::pos_type here = in.tellg();
+				if (here == unknown) return std::numeric_limits<std::uint64_t>::max();
+				in.seekg(0, std::ios::end);
+				std::istream::pos_type end = in.tellg();
+				in.seekg(here);
+				if (end == unknown || end < here) return std::numeric_limits<std::uint64_t>::max();
+				return std::uint64_t(end - here);
+			}
+
+			// Reads count * width values, failing without allocating when the
+			// file is too short to hold them
+			template <typename T>
+			bool readArray(std::istream& in, std::vector<T>& values, std::uint64_t count, std::uint64_t width = 1) {
+				if (count > remainingBytes(in) / (width * sizeof(T))) return false;
+				values.resize(std::size_t(count * width));
+				return values.empty() || bool(in.read(reinterpret_cast<char*>(values.data()), std::streamsize(values.size() * sizeof(T))));
+			}
+
+			inline bool readString(std::istream& in, std::string& value) {
+				std::uint32_t size;
+				if (!readPod(in, size) || size > remainingBytes(in)) return false;
+				value.resize(size);
+				return size == 0 || bool(in.read(&value[0], size));
+			}
+		}
+
+		inline void WriteColumnsBinary(std::ostream& out, const ColumnarBatch& batch) {
+			out.write(ColumnarMagic, sizeof(ColumnarMagic));
+			detail::writePod(out, ColumnarVersion);
+			detail::writePod(out, std::uint64_t(batch.count));
+			detail::writePod(out, std::uint32_t(batch.components.size()));
+
+			for (const ColumnarComponent& component : batch.components) {
+				std::uint64_t rowCount = component.hasRows ? component.rows.size() : batch.count;
+				detail::writeString(out, component.name);
+				detail::writePod(out, rowCount);
+				detail::writePod(out, std::uint8_t(component.hasRows));
+				if (component.hasRows) {
+					out.write(reinterpret_cast<const char*>(component.rows.data()), component.rows.size() * sizeof(std::uint64_t));
+				}
+				detail::writePod(out, std::uint32_t(component.columns.size()));
+				for (const ColumnData& column : component.columns) {
+					detail::writeString(out, column.name);
+					detail::writePod(out, std::uint8_t(column.type));
+					out.write(column.bytes.data(), column.bytes.size());
+				}
+			}
+		}
+
+		inline bool ReadColumnsBinary(std::istream& in, ColumnarBatch& batch, ColumnarImportReport& report) {
+			char magic[4];
+			std::uint32_t version, componentCount;
+			std::uint64_t count;
+			if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, ColumnarMagic, sizeof(magic)) != 0 ||
+				!detail::readPod(in, version) || version != ColumnarVersion ||
+				!detail::readPod(in, count) || !detail::readPod(in, componentCount)) {
+				report.errors.push_back("not a columnar batch or unsupported version");
+				return false;
+			}
+
+			if (count > std::numeric_limits<std::size_t>::max()) {
+				report.errors.push_back("entity count exceeds the address space");
+				return false;
+			}
+
+			// Smallest encoding of a component and of a column header
+			const std::uint64_t componentBytes = sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::uint8_t) + sizeof(std::uint32_t);
+			const std::uint64_t columnBytes = sizeof(std::uint32_t) + sizeof(std::uint8_t);
+			if (componentCount > detail::remainingBytes(in) / componentBytes) {
+				report.errors.push_back("component count exceeds the batch size");
+				return false;
+			}
+
+			batch.count = std::size_t(count);
+			batch.components.assign(componentCount, ColumnarComponent());
+			for (ColumnarComponent& component : batch.components) {
+				std::uint64_t rowCount;
+				std::uint8_t hasRows;
+				std::uint32_t columnCount;
+				if (!detail::readString(in, component.name) || !detail::readPod(in, rowCount) || !detail::readPod(in, hasRows)) {
+					report.errors.push_back("truncated component header");
+					return false;
+				}
+				component.hasRows = hasRows != 0;
+				// Rowless columns hold one value per entity, which bounds count
+				// by the bytes left once the component has columns
+				if (!component.hasRows && rowCount != count) {
+					report.errors.push_back(component.name + ": " + std::to_string(rowCount) + " rows for " + std::to_string(count) + " entities");
+					return false;
+				}
+				if (component.hasRows && !detail::readArray(in, component.rows, rowCount)) {
+					report.errors.push_back(component.name + ": truncated rows");
+					return false;
+				}
+				if (!detail::readPod(in, columnCount)) {
+					report.errors.push_back(component.name + ": truncated column count");
+					return false;
+				}
+				if (columnCount > detail::remainingBytes(in) / columnBytes) {
+					report.errors.push_back(component.name + ": column count exceeds the batch size");
+					return false;
+				}
+
+				component.columns.assign(columnCount, ColumnData());
+				for (ColumnData& column : component.columns) {
+					std::uint8_t type;
+					if (!detail::readString(in, column.name) || !detail::readPod(in, type) || type > std::uint8_t(ColumnType::UInt64)) {
+						report.errors.push_back(component.name + ": bad column header");
+						return false;
+					}
+					column.type = ColumnType(type);
+					if (!detail::readArray(in, column.bytes, rowCount, ColumnTypeSize(column.type))) {
+						report.errors.push_back(component.name + "." + column.name + ": truncated values");
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		namespace detail {
+			template <typename TTuple, typename TFunc, std::size_t... Is>
+			void forEachField(const TTuple& fields, TFunc&& func, std::index_sequence<Is...>) {
+				(void)std::initializer_list<int>{ (func(std::get<Is>(fields)), 0)... };
+			}
+
+			template <typename TTuple, typename TFunc>
+			void forEachField(const TTuple& fields, TFunc&& func) {
+				forEachField(fields, func, std::make_index_sequence<std::tuple_size<TTuple>::value>());
+			}
+
+			template <typename TComponent>
+			bool validateComponent(const ColumnarBatch& batch, const ColumnarComponent& columns, ColumnarImportReport& report) {
+				const std::string& name = columns.name;
+				std::size_t rowCount = columns.hasRows ? columns.rows.size() : batch.count;
+				std::size_t errors = report.errors.size();
+
+				if (!ComponentFields<TComponent>::Described) {
+					report.errors.push_back(name + ": component has no ComponentFields description");
+					return false;
+				}
+
+				// Sorted copy rather than a per-entity bitmap, so the check
+				// allocates by the rows given and not by batch.count
+				if (columns.hasRows) {
+					std::vector<std::uint64_t> sorted(columns.rows);
+					std::sort(sorted.begin(), sorted.end());
+					if (!sorted.empty() && sorted.back() >= batch.count) {
+						report.errors.push_back(name + ": row " + std::to_string(sorted.back()) + " out of range");
+					}
+					auto repeated = std::adjacent_find(sorted.begin(), sorted.end());
+					if (repeated != sorted.end()) {
+						report.errors.push_back(name + ": row " + std::to_string(*repeated) + " listed twice");
+					}
+				}
+
+				for (const ColumnData& column : columns.columns) {
+					bool known = false;
+					forEachField(ComponentFields<TComponent>::Get(), [&](const auto& field) {
+						known = known || column.name == field.name;
+					});
+					if (!known) {
+						report.warnings.push_back(name + "." + column.name + ": unknown field ignored");
+					}
+					else if (column.Size() != rowCount) {
+						report.errors.push_back(name + "." + column.name + ": " + std::to_string(column.Size()) +
+							" values for " + std::to_string(rowCount) + " rows");
+					}
+				}
+
+				forEachField(ComponentFields<TComponent>::Get(), [&](const auto& field) {
+					bool present = false;
+					for (const ColumnData& column : columns.columns) {
+						present = present || column.name == field.name;
+					}
+					if (!present) {
+						report.warnings.push_back(name + "." + field.name + ": missing, left value-initialized");
+					}
+				});
+
+				return report.errors.size() == errors;
+			}
+
+			// Converts every column once, then adds one component per row
+			template <typename TComponent, typename TSettings>
+			void importComponent(TEntitySystem<TSettings>& entitySystem, const ColumnarBatch& batch, const ColumnarComponent& columns,
+				const std::vector<typename TSettings::Entity>& entities) {
+				std::size_t rowCount = columns.hasRows ? columns.rows.size() : batch.count;
+
+				std::vector<TComponent> components(rowCount, TComponent());
+				forEachField(ComponentFields<TComponent>::Get(), [&](const auto& field) {
+					using Member = std::remove_reference_t<decltype(std::declval<TComponent&>().*field.member)>;
+					for (const ColumnData& column : columns.columns) {
+						if (column.name != field.name) continue;
+
+						std::vector<Member> values;
+						column.CopyTo(values);
+						for (std::size_t row = 0; row < rowCount; ++row) {
+							components[row].*field.member = values[row];
+						}
+					}
+				});
+
+				entitySystem.template ReserveComponents<TComponent>(rowCount);
+				for (std::size_t row = 0; row < rowCount; ++row) {
+					std::size_t entity = columns.hasRows ? std::size_t(columns.rows[row]) : row;
+					entitySystem.template EmplaceComponent<TComponent>(entities[entity], std::move(components[row]));
+				}
+			}
+		}
+
+		// Validates the whole batch, then creates batch.count entities and
+		// loads every component column into them. Nothing is created when
+		// validation reports an error. Created handles are appended to
+		// `entities` in batch row order when given.
+		template <typename TSettings>
+		bool ImportColumns(TEntitySystem<TSettings>& entitySystem, const ColumnarBatch& batch, ColumnarImportReport& report,
+			std::vector<typename TSettings::Entity>* entities = nullptr) {
+			using ComponentList = typename TSettings::ComponentList;
+
+			if (batch.count > TEntitySystem<TSettings>::MaxHandleIndex) {
+				report.errors.push_back(std::to_string(batch.count) + " entities exceed the handle space");
+				return false;
+			}
+
+			std::vector<const ColumnarComponent*> matched(batch.components.size(), nullptr);
+			for (std::size_t i = 0; i < batch.components.size(); ++i) {
+				const ColumnarComponent& columns = batch.components[i];
+				ComponentList::ForTypes([&](auto t) {
+					using ComponentType = TYPE_OF(t);
+					if (matched[i] == nullptr && ComponentType().Name() == columns.name) {
+						matched[i] = &columns;
+						detail::validateComponent<ComponentType>(batch, columns, report);
+					}
+				});
+				if (matched[i] == nullptr) {
+					report.warnings.push_back(columns.name + ": unknown component ignored");
+				}
+			}
+			if (!report.Ok()) {
+				return false;
+			}
+
+			std::vector<typename TSettings::Entity> created;
+			try {
+				created.reserve(batch.count);
+				entitySystem.Reserve(batch.count);
+			}
+			catch (const std::exception&) {
+				report.errors.push_back("cannot reserve " + std::to_string(batch.count) + " entities");
+				return false;
+			}
+			for (std::size_t i = 0; i < batch.count; ++i) {
+				created.push_back(entitySystem.CreateEntity());
+			}
+
+			for (std::size_t i = 0; i < batch.components.size(); ++i) {
+				if (matched[i] == nullptr) continue;
+				ComponentList::ForTypes([&](auto t) {
+					using ComponentType = TYPE_OF(t);
+					if (ComponentType().Name() == matched[i]->name) {
+						detail::importComponent<ComponentType>(entitySystem, batch, *matched[i], created);
+						++report.components;
+					}
+				});
+			}
+
+			report.entities += batch.count;
+			if (entities) {
+				entities->insert(entities->end(), created.begin(), created.end());
+			}
+			return true;
+		}
+
+	}
+}
\ No newline at end of file
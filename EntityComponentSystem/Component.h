@@ -1,17 +1,18 @@
-#pragma once
-
-#include "json/json.h"
-#include "TIndexMemoryPool.h"
-
-namespace ecs {
-	static constexpr std::size_t COMPONENT_POOL_SIZE = 1024U;
-
-	template <typename ComponentType>
-	using ComponentPool = TIndexMemoryPool<ComponentType, COMPONENT_POOL_SIZE>;
-
-	struct Component {
-		virtual std::string Name() const = 0;
-		virtual void Serialize(Json::Value& root) const = 0;
-		virtual void Deserialize(const Json::Value& root) = 0;
-	};
+#pragma once
+
+#include "json/json.h"
+#include "TIndexMemoryPool.h"
+
+namespace ecs {
+	// Number of components allocated per pool page
+	static constexpr std::size_t COMPONENT_POOL_SIZE = 1024U;
+
+	template <typename ComponentType, typename TAllocator = std::allocator<ComponentType>>
+	using ComponentPool = TIndexMemoryPool<ComponentType, COMPONENT_POOL_SIZE, TAllocator>;
+
+	struct Component {
+		virtual std::string Name() const = 0;
+		virtual void Serialize(Json::Value& root) const = 0;
+		virtual void Deserialize(const Json::Value& root) = 0;
+	};
 }
\ No newline at end of file
@@ -1,9 +1,23 @@
-#pragma once
-
-#include "Reflection.h"
-#include "Settings.h"
-#include "TEntitySystem.h"
-#include "TEntityPrototype.h"
-#include "EntityParser.h"
-#include "Entity.h"
-#include "Component.h"
\ No newline at end of file
+#pragma once
+
+#include "Reflection.h"
+#include "Settings.h"
+#include "TEntitySystem.h"
+#include "TProfiler.h"
+#include "TTagColumns.h"
+#include "TEventQueue.h"
+#include "TSharedStore.h"
+#include "FrameArena.h"
+#include "ThreadPool.h"
+#include "MemoryStats.h"
+#include "MemoryResource.h"
+#include "Span.h"
+#include "TSpatialIndex.h"
+#include "TEntityPrototype.h"
+#include "FastJson.h"
+#include "EntityParser.h"
+#include "ColumnarImport.h"
+#include "PrototypeCache.h"
+#include "Entity.h"
+#include "Component.h"
+#include "MappedFile.h"
\ No newline at end of file
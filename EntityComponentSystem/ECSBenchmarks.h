@@ -0,0 +1,645 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <random>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include "TestComponents.h"
+#include "EntityParser.h"
+#include "ColumnarImport.h"
+#include "PrototypeCache.h"
+
+namespace ecs {
+	namespace bench {
+
+		using namespace ecs::test;
+
+		using EntitySystem = TEntitySystem<MySettings>;
+		using EntityPrototype = TEntityPrototype<MySettings>;
+
+		struct BenchmarkOptions {
+			std::size_t minEntities{ 1000 };
+			std::size_t maxEntities{ 10000000 };
+			double minTime{ 0.2 };
+			std::size_t maxIterations{ 1000 };
+			std::string filter;
+			std::string jsonPath;
+		};
+
+		struct BenchmarkResult {
+			std::string name;
+			std::size_t entities;
+			std::size_t items;
+			std::size_t iterations;
+			double meanNs;
+			double minNs;
+		};
+
+		// Measures only the code between Start() and Stop(), so each iteration
+		// can rebuild its fixture without polluting the result.
+
+		class Timer {
+		public:
+			void Start() { m_start = Clock::now(); }
+
+			void Stop() {
+				m_last = std::chrono::duration<double, std::nano>(Clock::now() - m_start).count();
+			}
+
+			double LastNs() const { return m_last; }
+
+		private:
+			using Clock = std::chrono::steady_clock;
+			Clock::time_point m_start;
+			double m_last{ 0 };
+		};
+
+		// Keeps benchmarked reads from being optimized away
+
+		static volatile float g_sink = 0;
+
+		class BenchmarkRunner {
+		public:
+			explicit BenchmarkRunner(const BenchmarkOptions& options) : m_options{ options } {}
+
+			template <typename TFunc>
+			void Run(const std::string& name, std::size_t entities, std::size_t items, TFunc&& func) {
+				if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) {
+					return;
+				}
+
+				Timer timer;
+				double total{ 0 }, best{ 0 };
+				std::size_t iterations{ 0 };
+				while (iterations < m_options.maxIterations && (iterations == 0 || total < m_options.minTime * 1e9)) {
+					func(timer);
+					double ns = timer.LastNs();
+					best = (iterations == 0) ? ns : std::min(best, ns);
+					total += ns;
+					++iterations;
+				}
+
+				BenchmarkResult result{ name, entities, items, iterations, total / iterations, best };
+				m_results.push_back(result);
+
+				std::cout << std::left << std::setw(44) << name
+					<< std::right << std::setw(12) << std::fixed << std::setprecision(0) << result.meanNs << " ns"
+					<< std::setw(10) << std::setprecision(2) << result.meanNs / std::max<std::size_t>(items, 1) << " ns/item"
+					<< std::setw(8) << iterations << " iters" << std::endl;
+			}
+
+			// Writes results in a layout compatible with Google Benchmark's JSON
+			// reporter so the usual compare tools can diff two runs.
+			void WriteJson(std::ostream& out) const {
+				Json::Value root;
+				Json::Value& context = root["context"];
+				context["num_cpus"] = std::thread::hardware_concurrency();
+#ifdef NDEBUG
+				context["library_build_type"] = "release";
+#else
+				context["library_build_type"] = "debug";
+#endif
+				context["min_time"] = m_options.minTime;
+
+				Json::Value& benchmarks = root["benchmarks"];
+				benchmarks = Json::Value(Json::arrayValue);
+				for (const BenchmarkResult& result : m_results) {
+					Json::Value entry;
+					entry["name"] = result.name;
+					entry["entities"] = Json::UInt64(result.entities);
+					entry["iterations"] = Json::UInt64(result.iterations);
+					entry["real_time"] = result.meanNs;
+					entry["best_time"] = result.minNs;
+					entry["time_unit"] = "ns";
+					entry["items_per_second"] = result.meanNs > 0 ? result.items * 1e9 / result.meanNs : 0.0;
+					benchmarks.append(entry);
+				}
+
+				Json::StyledStreamWriter writer;
+				writer.write(out, root);
+			}
+
+		private:
+			BenchmarkOptions m_options;
+			std::vector<BenchmarkResult> m_results;
+		};
+
+		// Fixtures
+
+		inline PositionComponent MakePosition(float v) {
+			PositionComponent p;
+			p.x = v; p.y = v; p.z = v;
+			return p;
+		}
+
+		inline HealthComponent MakeHealth(float v) {
+			HealthComponent h;
+			h.health = v; h.maxHealth = v;
+			return h;
+		}
+
+		// Every entity has a PositionComponent; a deterministic fraction also
+		// gets a HealthComponent so that S1 matches `ratio` of the world.
+		template <typename TEntitySystem>
+		inline std::vector<Entity> Populate(TEntitySystem& system, std::size_t count, double ratio) {
+			std::vector<Entity> entities;
+			entities.reserve(count);
+			std::mt19937 rng(1234);
+			std::bernoulli_distribution hasHealth(ratio);
+			for (std::size_t i = 0; i < count; ++i) {
+				Entity e = system.CreateEntity();
+				system.AddComponent(e, MakePosition(float(i)));
+				if (hasHealth(rng)) {
+					system.AddComponent(e, MakeHealth(100.0f));
+				}
+				entities.push_back(e);
+			}
+			system.Refresh();
+			return entities;
+		}
+
+		inline std::string Label(const std::string& name, std::size_t count) {
+			return name + "/" + std::to_string(count);
+		}
+
+		inline std::string Label(const std::string& name, std::size_t count, double ratio) {
+			return Label(name, count) + "/" + std::to_string(int(ratio * 100 + 0.5)) + "%";
+		}
+
+		inline EntityPrototype LoadCowPrototype() {
+			std::string entityData =
+				"{\"cow\": {"
+				"\"healthComponent\": { \"health\": 40, \"maxHealth\": 50 },"
+				"\"positionComponent\": { \"x\": 5, \"y\": 10, \"z\": 15 }"
+				"}}";
+			Json::Value root;
+			Json::Reader reader;
+			reader.parse(entityData, root, false);
+			return EntityParser::ParseTypes<MySettings>(root).front();
+		}
+
+		// Level of `count` entities with positions, health on every other one
+		inline Json::Value MakeLevelColumns(std::size_t count) {
+			Json::Value root;
+			root["count"] = Json::UInt64(count);
+			Json::Value& position = root["components"]["positionComponent"];
+			Json::Value& health = root["components"]["healthComponent"];
+			for (std::size_t i = 0; i < count; ++i) {
+				position["x"].append(double(i) + 0.5);
+				position["y"].append(double(i));
+				position["z"].append(0.25);
+				if (i % 2 == 0) {
+					health["rows"].append(Json::UInt64(i));
+					health["health"].append(100);
+					health["maxHealth"].append(100);
+				}
+			}
+			return root;
+		}
+
+		// The same level as one object per entity
+		inline Json::Value MakeLevelObjects(std::size_t count) {
+			Json::Value root(Json::arrayValue);
+			for (std::size_t i = 0; i < count; ++i) {
+				Json::Value entity;
+				entity["positionComponent"]["x"] = double(i) + 0.5;
+				entity["positionComponent"]["y"] = double(i);
+				entity["positionComponent"]["z"] = 0.25;
+				if (i % 2 == 0) {
+					entity["healthComponent"]["health"] = 100;
+					entity["healthComponent"]["maxHealth"] = 100;
+				}
+				root.append(entity);
+			}
+			return root;
+		}
+
+		// Prototype file with `count` entity types of one to three components
+		inline std::string MakePrototypeFile(std::size_t count) {
+			std::string text = "{\n";
+			for (std::size_t i = 0; i < count; ++i) {
+				text += "\t\"type" + std::to_string(i) + "\": {\n";
+				text += "\t\t\"positionComponent\": { \"x\": " + std::to_string(i) + ".25, \"y\": -3.5, \"z\": 1e2 }";
+				if (i % 2 == 0) {
+					text += ",\n\t\t\"healthComponent\": { \"health\": 40, \"maxHealth\": 50 }";
+				}
+				if (i % 3 == 0) {
+					text += ",\n\t\t\"renderableComponent\": { \"meshId\": " + std::to_string(i % 64) + " }";
+				}
+				text += i + 1 < count ? "\n\t},\n" : "\n\t}\n";
+			}
+			return text + "}\n";
+		}
+
+		// Same shape in trees of eight: one full base per tree, each variant
+		// extending it and overriding one field
+		inline std::string MakeInheritedPrototypeFile(std::size_t count) {
+			std::string text = "{\n";
+			for (std::size_t i = 0; i < count; ++i) {
+				text += "\t\"type" + std::to_string(i) + "\": {\n";
+				if (i % 8 == 0) {
+					text += "\t\t\"positionComponent\": { \"x\": " + std::to_string(i) + ".25, \"y\": -3.5, \"z\": 1e2 },\n";
+					text += "\t\t\"healthComponent\": { \"health\": 40, \"maxHealth\": 50 },\n";
+					text += "\t\t\"renderableComponent\": { \"meshId\": " + std::to_string(i % 64) + " }";
+				}
+				else {
+					text += "\t\t\"extends\": \"type" + std::to_string(i - i % 8) + "\",\n";
+					text += "\t\t\"healthComponent\": { \"health\": " + std::to_string(i % 8) + " }";
+				}
+				text += i + 1 < count ? "\n\t},\n" : "\n\t}\n";
+			}
+			return text + "}\n";
+		}
+
+		// Benchmarks
+
+		inline void BenchCreateEntity(BenchmarkRunner& runner, std::size_t count) {
+			runner.Run(Label("CreateEntity", count), count, count, [count](Timer& timer) {
+				EntitySystem system;
+				timer.Start();
+				for (std::size_t i = 0; i < count; ++i) {
+					system.CreateEntity();
+				}
+				timer.Stop();
+			});
+		}
+
+		inline void BenchAddComponent(BenchmarkRunner& runner, std::size_t count) {
+			runner.Run(Label("AddComponent", count), count, count, [count](Timer& timer) {
+				EntitySystem system;
+				std::vector<Entity> entities;
+				entities.reserve(count);
+				for (std::size_t i = 0; i < count; ++i) {
+					entities.push_back(system.CreateEntity());
+				}
+				PositionComponent p = MakePosition(1.0f);
+				timer.Start();
+				for (Entity e : entities) {
+					system.AddComponent(e, p);
+				}
+				timer.Stop();
+			});
+		}
+
+		inline void BenchRemoveComponent(BenchmarkRunner& runner, std::size_t count) {
+			runner.Run(Label("RemoveComponent", count), count, count, [count](Timer& timer) {
+				EntitySystem system;
+				std::vector<Entity> entities = Populate(system, count, 0.0);
+				timer.Start();
+				for (Entity e : entities) {
+					system.RemoveComponent<PositionComponent>(e);
+				}
+				timer.Stop();
+			});
+		}
+
+		inline void BenchGetComponent(BenchmarkRunner& runner, std::size_t count) {
+			EntitySystem system;
+			std::vector<Entity> entities = Populate(system, count, 0.0);
+			runner.Run(Label("GetComponent", count), count, count, [&system, &entities](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				for (Entity e : entities) {
+					sum += system.GetComponent<PositionComponent>(e).x;
+				}
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		inline void BenchForEntitiesMatching(BenchmarkRunner& runner, std::size_t count, double ratio) {
+			EntitySystem system;
+			Populate(system, count, ratio);
+			runner.Run(Label("ForEntitiesMatching", count, ratio), count, count, [&system](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				system.ForEntitiesMatching<S1>([&sum](EntityIndex, PositionComponent& p, HealthComponent& h) {
+					sum += p.x * h.health;
+				});
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		inline void BenchForChunks(BenchmarkRunner& runner, std::size_t count, double ratio) {
+			EntitySystem system;
+			Populate(system, count, ratio);
+			runner.Run(Label("ForChunks", count, ratio), count, count, [&system](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				system.ForChunks<S1>([&sum](TSpan<const EntityIndex>, TSpan<PositionComponent> p, TSpan<HealthComponent> h) {
+					for (std::size_t i = 0; i < p.size(); ++i) {
+						sum += p[i].x * h[i].health;
+					}
+				});
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		inline void BenchForGroup(BenchmarkRunner& runner, std::size_t count, double ratio) {
+			TEntitySystem<MyGroupSettings> system;
+			Populate(system, count, ratio);
+			runner.Run(Label("ForGroup", count, ratio), count, count, [&system](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				system.ForGroup<S1>([&sum](Entity, PositionComponent& p, HealthComponent& h) {
+					sum += p.x * h.health;
+				});
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		// Per-frame scratch vector of matching indices, from the heap and
+		// from the frame arena. Refresh() rewinds the arena outside the timer.
+		inline void BenchCollectHeap(BenchmarkRunner& runner, std::size_t count, double ratio) {
+			EntitySystem system;
+			Populate(system, count, ratio);
+			runner.Run(Label("CollectHeap", count, ratio), count, count, [&system](Timer& timer) {
+				timer.Start();
+				std::vector<EntityIndex> collected;
+				system.ForEntitiesMatching<S1>([&collected](EntityIndex index, PositionComponent&, HealthComponent&) {
+					collected.push_back(index);
+				});
+				g_sink = float(collected.size());
+				timer.Stop();
+			});
+		}
+
+		inline void BenchCollectFrame(BenchmarkRunner& runner, std::size_t count, double ratio) {
+			EntitySystem system;
+			Populate(system, count, ratio);
+			runner.Run(Label("CollectFrame", count, ratio), count, count, [&system](Timer& timer) {
+				timer.Start();
+				{
+					EntitySystem::FrameVector<EntityIndex> collected = system.MakeFrameVector<EntityIndex>();
+					system.ForEntitiesMatching<S1>([&collected](EntityIndex index, PositionComponent&, HealthComponent&) {
+						collected.push_back(index);
+					});
+					g_sink = float(collected.size());
+				}
+				timer.Stop();
+				system.Refresh();
+			});
+		}
+
+		// Full Defragment() pass over Position storage filled in reverse
+		// entity order with a third of the components removed
+		inline void BenchDefragment(BenchmarkRunner& runner, std::size_t count) {
+			runner.Run(Label("Defragment", count), count, count, [count](Timer& timer) {
+				EntitySystem system;
+				std::vector<Entity> entities(count);
+				for (Entity& e : entities) {
+					e = system.CreateEntity();
+				}
+				for (std::size_t i = count; i-- > 0;) {
+					system.AddComponent(entities[i], PositionComponent());
+				}
+				for (std::size_t i = 0; i < count; i += 3) {
+					system.RemoveComponent<PositionComponent>(entities[i]);
+				}
+				system.Refresh();
+				timer.Start();
+				system.Defragment<PositionComponent>();
+				timer.Stop();
+			});
+		}
+
+		// Health storage after churn: half the components removed, then a
+		// quarter re-added, walked through the sparse pool and as dense spans
+		template <typename TEntitySystem>
+		inline void Churn(TEntitySystem& system, const std::vector<Entity>& entities) {
+			std::mt19937 rng(99);
+			std::bernoulli_distribution remove(0.5), readd(0.5);
+			std::vector<Entity> removed;
+			for (Entity e : entities) {
+				if (remove(rng)) {
+					system.template RemoveComponent<HealthComponent>(e);
+					removed.push_back(e);
+				}
+			}
+			for (Entity e : removed) {
+				if (readd(rng)) {
+					system.AddComponent(e, MakeHealth(50.0f));
+				}
+			}
+		}
+
+		inline void BenchWalkSparse(BenchmarkRunner& runner, std::size_t count) {
+			EntitySystem system;
+			Churn(system, Populate(system, count, 1.0));
+			runner.Run(Label("WalkHealth/Sparse", count), count, count, [&system](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				system.ForEachComponent<HealthComponent>([&sum](Entity, HealthComponent& h) {
+					sum += h.health;
+				});
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		inline void BenchWalkDense(BenchmarkRunner& runner, std::size_t count) {
+			TEntitySystem<MyDenseSettings> system;
+			Churn(system, Populate(system, count, 1.0));
+			runner.Run(Label("WalkHealth/Dense", count), count, count, [&system](Timer& timer) {
+				float sum = 0;
+				timer.Start();
+				system.ForComponentSpans<HealthComponent>([&sum](TSpan<const Entity>, TSpan<HealthComponent> h) {
+					for (const HealthComponent& health : h) {
+						sum += health.health;
+					}
+				});
+				timer.Stop();
+				g_sink = sum;
+			});
+		}
+
+		inline void BenchRefresh(BenchmarkRunner& runner, std::size_t count, double killRatio) {
+			runner.Run(Label("Refresh", count, killRatio), count, count, [count, killRatio](Timer& timer) {
+				EntitySystem system;
+				std::vector<Entity> entities = Populate(system, count, 0.5);
+				std::mt19937 rng(4321);
+				std::bernoulli_distribution kill(killRatio);
+				for (Entity e : entities) {
+					if (kill(rng)) {
+						system.Kill(e);
+					}
+				}
+				timer.Start();
+				system.Refresh();
+				timer.Stop();
+			});
+		}
+
+		inline void BenchPrototypeInstantiate(BenchmarkRunner& runner, std::size_t count) {
+			EntityPrototype prototype = LoadCowPrototype();
+			runner.Run(Label("PrototypeInstantiate", count), count, count, [count, &prototype](Timer& timer) {
+				EntitySystem system;
+				timer.Start();
+				for (std::size_t i = 0; i < count; ++i) {
+					prototype.CreateEntity(system);
+				}
+				timer.Stop();
+			});
+		}
+
+		inline void BenchObjectImport(BenchmarkRunner& runner, std::size_t count) {
+			Json::Value level = MakeLevelObjects(count);
+			runner.Run(Label("ObjectImport", count), count, count, [&level](Timer& timer) {
+				EntitySystem system;
+				timer.Start();
+				for (const Json::Value& object : level) {
+					EntityParser::CreatePrototype<MySettings>("", object).CreateEntity(system);
+				}
+				timer.Stop();
+			});
+		}
+
+		inline void BenchColumnarImport(BenchmarkRunner& runner, std::size_t count) {
+			ColumnarBatch batch;
+			ColumnarImportReport report;
+			EntityParser::ParseColumns(MakeLevelColumns(count), batch, report);
+			runner.Run(Label("ColumnarImport", count), count, count, [&batch](Timer& timer) {
+				EntitySystem system;
+				ColumnarImportReport report;
+				timer.Start();
+				EntityParser::ImportColumns(system, batch, report);
+				timer.Stop();
+			});
+		}
+
+		inline void BenchPrototypeParseJsoncpp(BenchmarkRunner& runner, std::size_t count) {
+			std::string text = MakePrototypeFile(count);
+			runner.Run(Label("PrototypeParse/jsoncpp", count), count, count, [&text](Timer& timer) {
+				timer.Start();
+				Json::Value root;
+				Json::Reader reader;
+				reader.parse(text, root, false);
+				std::vector<EntityPrototype> prototypes = EntityParser::ParseTypes<MySettings>(root);
+				timer.Stop();
+				g_sink = float(prototypes.size());
+			});
+		}
+
+		inline void BenchPrototypeParseFastJson(BenchmarkRunner& runner, std::size_t count) {
+			std::string text = MakePrototypeFile(count);
+			runner.Run(Label("PrototypeParse/FastJson", count), count, count, [&text](Timer& timer) {
+				timer.Start();
+				FastJson::Document document;
+				document.Parse(text);
+				std::vector<EntityPrototype> prototypes = EntityParser::ParseTypes<MySettings>(document.Root());
+				timer.Stop();
+				g_sink = float(prototypes.size());
+			});
+		}
+
+		inline void BenchPrototypeParseInherited(BenchmarkRunner& runner, std::size_t count) {
+			std::string text = MakeInheritedPrototypeFile(count);
+			ThreadPool pool;
+			runner.Run(Label("PrototypeParse/Inherited", count), count, count, [&text, &pool](Timer& timer) {
+				timer.Start();
+				FastJson::Document document;
+				document.Parse(text);
+				PrototypeParseReport report;
+				std::vector<EntityPrototype> prototypes = EntityParser::ParseTypes<MySettings>(document.Root(), report, &pool);
+				timer.Stop();
+				g_sink = float(prototypes.size());
+			});
+		}
+
+		// Whole load of one prototype file, parsed or from a warm cache
+		inline void BenchPrototypeLoad(BenchmarkRunner& runner, std::size_t count, bool cached) {
+			const std::string path = "ecs_bench_prototypes.json", cachePath = cached ? "ecs_bench_prototypes.cache" : "";
+			std::ofstream(path, std::ios::binary) << MakePrototypeFile(count);
+			PrototypeParseReport warmup;
+			EntityParser::LoadPrototypes<MySettings>({ path }, cachePath, warmup);
+
+			runner.Run(Label(cached ? "PrototypeLoad/Cached" : "PrototypeLoad/Parsed", count), count, count, [&path, &cachePath](Timer& timer) {
+				timer.Start();
+				PrototypeParseReport report;
+				std::vector<EntityPrototype> prototypes = EntityParser::LoadPrototypes<MySettings>({ path }, cachePath, report);
+				timer.Stop();
+				g_sink = float(prototypes.size());
+			});
+
+			std::remove(path.c_str());
+			if (cached) std::remove(cachePath.c_str());
+		}
+
+		// The same prototypes split over 16 files, loaded on a pool
+		inline void BenchPrototypeLoadParallel(BenchmarkRunner& runner, std::size_t count) {
+			std::vector<std::string> paths;
+			for (std::size_t f = 0; f < 16; ++f) {
+				paths.push_back("ecs_bench_prototypes" + std::to_string(f) + ".json");
+				std::string text = MakePrototypeFile(count / 16);
+				std::string prefix = "\"f" + std::to_string(f) + "type";
+				for (std::size_t at = text.find("\"type"); at != std::string::npos; at = text.find("\"type", at + prefix.size())) {
+					text.replace(at, 5, prefix);
+				}
+				std::ofstream(paths.back(), std::ios::binary) << text;
+			}
+			ThreadPool pool;
+
+			runner.Run(Label("PrototypeLoad/Parallel", count), count, count, [&paths, &pool](Timer& timer) {
+				timer.Start();
+				PrototypeParseReport report;
+				std::vector<EntityPrototype> prototypes = EntityParser::LoadPrototypes<MySettings>(paths, "", report, &pool);
+				timer.Stop();
+				g_sink = float(prototypes.size());
+			});
+
+			for (const std::string& path : paths) {
+				std::remove(path.c_str());
+			}
+		}
+
+		inline void RunBenchmarks(const BenchmarkOptions& options) {
+			BenchmarkRunner runner(options);
+
+			for (std::size_t count = options.minEntities; count <= options.maxEntities; count *= 10) {
+				BenchCreateEntity(runner, count);
+				BenchAddComponent(runner, count);
+				BenchRemoveComponent(runner, count);
+				BenchGetComponent(runner, count);
+				for (double ratio : { 0.01, 0.1, 0.5, 1.0 }) {
+					BenchForEntitiesMatching(runner, count, ratio);
+					BenchForChunks(runner, count, ratio);
+					BenchForGroup(runner, count, ratio);
+					BenchCollectHeap(runner, count, ratio);
+					BenchCollectFrame(runner, count, ratio);
+				}
+				for (double killRatio : { 0.01, 0.1, 0.5, 0.9 }) {
+					BenchRefresh(runner, count, killRatio);
+				}
+				BenchDefragment(runner, count);
+				BenchWalkSparse(runner, count);
+				BenchWalkDense(runner, count);
+				BenchPrototypeInstantiate(runner, count);
+				BenchObjectImport(runner, count);
+				BenchColumnarImport(runner, count);
+				// Prototype files beyond 100k entries are not a realistic workload
+				if (count <= 100000) {
+					BenchPrototypeParseJsoncpp(runner, count);
+					BenchPrototypeParseFastJson(runner, count);
+					BenchPrototypeParseInherited(runner, count);
+					BenchPrototypeLoad(runner, count, false);
+					BenchPrototypeLoad(runner, count, true);
+					BenchPrototypeLoadParallel(runner, count);
+				}
+			}
+
+			if (!options.jsonPath.empty()) {
+				std::ofstream out(options.jsonPath);
+				runner.WriteJson(out);
+			}
+		}
+
+	}
+}
\ No newline at end of file
@@ -1,233 +1,1384 @@
-#pragma once
-
-#include <cassert>
-#include <iostream>
-#include "Reflection.h"
-#include "Settings.h"
-#include "TEntitySystem.h"
-#include "EntityParser.h"
-
-namespace ecs {
-	namespace test {
-
-		struct PositionComponent : public Component {
-			float x;
-			float y;
-			float z;
-
-			std::string Name() const { return "positionComponent"; }
-			void Serialize(Json::Value& root) const {};
-			void Deserialize(const Json::Value& root) {
-				x = root.get("x", "-1").asFloat();
-				y = root.get("y", "-1").asFloat();
-				z = root.get("z", "-1").asFloat();
-			};
-		};
-
-		struct HealthComponent : public Component {
-			float health;
-			float maxHealth;
-
-			std::string Name() const { return "healthComponent"; }
-			void Serialize(Json::Value& root) const {};
-			void Deserialize(const Json::Value& root) {
-				health = root.get("health", "-1").asFloat();
-				maxHealth = root.get("maxHealth", "-1").asFloat();
-			};
-		};
-
-		struct RenderableComponent : public Component {
-			int meshId;
-
-			std::string Name() const { return "renderableComponent"; }
-			void Serialize(Json::Value& root) const {};
-			void Deserialize(const Json::Value& root) {
-				meshId = root.get("meshId", "-1").asInt();
-			};
-		};
-
-		using MyComponentList = Refl::TypeList<PositionComponent, HealthComponent, RenderableComponent>;
-
-		struct T0 {};
-		struct T1 {};
-		struct T2 {};
-		using MyTagList = Refl::TypeList<T0, T1, T2>;
-
-		using S0 = Refl::TypeList<>;
-		using S1 = Refl::TypeList<PositionComponent, HealthComponent>;
-		using S2 = Refl::TypeList<PositionComponent, RenderableComponent, T0>;
-		using S3 = Refl::TypeList<HealthComponent, T0, RenderableComponent, T2>;
-		using MySignatureList = Refl::TypeList<S0, S1, S2, S3>;
-
-		using MySettings = Settings<MyComponentList, MyTagList, MySignatureList>;
-
-		static_assert(MySettings::ComponentCount == 3, "");
-		static_assert(MySettings::TagCount == 3, "");
-		static_assert(MySettings::SignatureCount == 4, "");
-
-		static_assert(MySettings::ComponentId<PositionComponent>() == 0, "");
-		static_assert(MySettings::ComponentId<HealthComponent>() == 1, "");
-		static_assert(MySettings::ComponentId<RenderableComponent>() == 2, "");
-
-		static_assert(MySettings::TagId<T0>() == 0, "");
-		static_assert(MySettings::TagId<T1>() == 1, "");
-		static_assert(MySettings::TagId<T2>() == 2, "");
-
-		static_assert(MySettings::SignatureId<S0>() == 0, "");
-		static_assert(MySettings::SignatureId<S1>() == 1, "");
-		static_assert(MySettings::SignatureId<S2>() == 2, "");
-		static_assert(MySettings::SignatureId<S3>() == 3, "");
-
-		using MySignatureBitset = typename MySettings::SignatureBitset;
-
-		static_assert(std::is_same
-			<
-			MySignatureBitset::SignatureComponents<S0>,
-			Refl::TypeList<>
-			>::value, "");
-
-		static_assert(std::is_same
-			<
-			MySignatureBitset::SignatureComponents<S3>,
-			Refl::TypeList<HealthComponent, RenderableComponent>
-			>::value, "");
-
-		static_assert(std::is_same
-			<
-			MySignatureBitset::SignatureTags<S3>,
-			Refl::TypeList<T0, T2>
-			>::value, "");
-
-		void RuntimeTests() {
-			using Bitset = typename MySignatureBitset::Bitset;
-			Sig::SignatureBitsetStorage<MySettings> msb;
-
-			const auto& bS0(msb.GetSignatureBitset<S0>());
-			const auto& bS1(msb.GetSignatureBitset<S1>());
-			const auto& bS2(msb.GetSignatureBitset<S2>());
-			const auto& bS3(msb.GetSignatureBitset<S3>());
-
-			assert(bS0 == Bitset{ "000000" });
-			assert(bS1 == Bitset{ "000011" });
-			assert(bS2 == Bitset{ "001101" });
-			assert(bS3 == Bitset{ "101110" });
-
-			std::cout << "Signature bitset tests passed!" << std::endl;
-
-			using EntitySystem = TEntitySystem<MySettings>;
-			using EntityPrototype = TEntityPrototype<MySettings>;
-
-			EntitySystem entitySystem;
-
-			// Test component insertion, modification, and deletion
-
-			Entity e = entitySystem.CreateEntity();
-
-			PositionComponent p0;
-			p0.x = 12;
-			p0.y = 32;
-			p0.z = 50;
-
-			entitySystem.AddComponent(e, p0);
-
-			PositionComponent& p1 = entitySystem.GetComponent<PositionComponent>(e);
-			assert(p1.x == 12 && p1.y == 32 && p1.z == 50);
-
-			p1.y = 101;
-
-			PositionComponent& p2 = entitySystem.GetComponent<PositionComponent>(e);
-			assert(p2.x == 12 && p2.y == 101 && p2.z == 50);
-
-			bool removed = entitySystem.RemoveComponent<PositionComponent>(e);
-			assert(removed);
-
-			std::cout << "Component insertion, modification, and deletion tests passed!" << std::endl;
-
-			// Test removal of entity
-
-			Entity e1 = entitySystem.CreateEntity();
-			Entity e2 = entitySystem.CreateEntity();
-			entitySystem.AddComponent(e2, p0);
-			Entity e3 = entitySystem.CreateEntity();
-			Entity e4 = entitySystem.CreateEntity();
-			entitySystem.AddComponent(e4, p0);
-
-			entitySystem.Kill(e2);
-			entitySystem.Refresh();
-
-			assert(entitySystem.IsHandleValid(e2) == false);
-
-			PositionComponent& p4 = entitySystem.GetComponent<PositionComponent>(e4);
-			assert(p4.x == 12 && p4.y == 32 && p4.z == 50);
-
-			std::cout << "Entity removal tests passed!" << std::endl;
-
-			// Check signature matching
-
-			Entity e5 = entitySystem.CreateEntity();
-			entitySystem.AddComponent(e5, PositionComponent());
-			entitySystem.AddComponent(e5, HealthComponent());
-			entitySystem.AddComponent(e5, p0);
-			entitySystem.Refresh();
-			assert(entitySystem.MatchesSignature<S0>(e5));
-			assert(entitySystem.MatchesSignature<S1>(e5));
-			assert(entitySystem.MatchesSignature<S2>(e5) == false);
-			assert(entitySystem.MatchesSignature<S3>(e5) == false);
-
-			std::cout << "Signature matching tests passed!" << std::endl;
-
-			// Entity iteration
-
-			entitySystem.ForEntitiesMatching<S1>([](EntityIndex i, PositionComponent& c1, HealthComponent& c2) {
-				std::cout << "entity " << i << std::endl;
-			});
-
-			// Test entity prototype generation
-
-			EntitySystem system;
-
-			std::string entityData =
-				"{\
-				\"entities\": {\
-					\"cow\": {\
-						\"healthComponent\": {\
-							\"health\": 40,\
-							\"maxHealth\": 50\
-						},\
-						\"positionComponent\": {\
-							\"x\": 5,\
-							\"y\": 10,\
-							\"z\": 15\
-						}\
-					}\
-				}\
-			}";
-			std::istringstream inputStream(entityData, std::istream::binary);
-			Json::Value root;
-			Json::Reader reader;
-			bool success = reader.parse(inputStream, root, false);
-			if (!success) {
-				std::cout << reader.getFormattedErrorMessages() << std::endl;
-			}
-			root = root.get("entities", "");
-			std::vector<EntityPrototype> entityTypes = EntityParser::ParseTypes<MySettings>(root);
-
-			for (std::size_t i = 0; i < entityTypes.size(); ++i) {
-				EntityPrototype& type = entityTypes[i];
-
-				Entity e = type.CreateEntity(system);
-
-				std::cout << type.GetName() << " should have component #0, #1" << std::endl;
-				MyComponentList::ForTypes([&system, &e](auto t) {
-					if (system.HasComponent<TYPE_OF(t)>(e)) {
-						std::cout << "  has component #" << MySettings::ComponentBit<TYPE_OF(t)>() << std::endl;
-					}
-				});
-
-			}
-
-			std::cout << "Runtime tests passed!" << std::endl;
-		}
-
-	}
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+#include "TestComponents.h"
+#include "TEntitySystem.h"
+#include "EntityParser.h"
+#include "TSpatialIndex.h"
+#include "ColumnarImport.h"
+#include "PrototypeCache.h"
+
+namespace ecs {
+	namespace test {
+
+		// Component with a heap member that counts its copies
+		struct InventoryComponent : public Component {
+			static int& Copies() {
+				static int copies = 0;
+				return copies;
+			}
+
+			std::vector<int> items;
+
+			InventoryComponent() {}
+			explicit InventoryComponent(std::size_t count) : items(count, 1) {}
+			InventoryComponent(const InventoryComponent& other) : items(other.items) { ++Copies(); }
+			InventoryComponent(InventoryComponent&&) = default;
+			InventoryComponent& operator=(const InventoryComponent& other) { items = other.items; ++Copies(); return *this; }
+			InventoryComponent& operator=(InventoryComponent&&) = default;
+
+			std::string Name() const { return "inventoryComponent"; }
+			void Serialize(Json::Value& root) const {};
+			void Deserialize(const Json::Value& root) {};
+		};
+
+		using MyInventorySettings = Settings<Refl::TypeList<InventoryComponent, PositionComponent>, Refl::TypeList<>, Refl::TypeList<>>;
+
+		// Described for columnar import, but the text is not a field
+		struct LabelComponent : public Component {
+			std::string text;
+			float scale{ 1 };
+
+			std::string Name() const { return "labelComponent"; }
+			void Serialize(Json::Value& root) const {};
+			void Deserialize(const Json::Value& root) {
+				text = root.get("text", "").asString();
+				scale = root.get("scale", 1.0f).asFloat();
+			};
+		};
+
+		using MyLabelSettings = Settings<Refl::TypeList<LabelComponent, PositionComponent>, Refl::TypeList<>, Refl::TypeList<>>;
+	}
+
+	template <>
+	struct ComponentFields<test::LabelComponent> {
+		static constexpr bool Described = true;
+		static auto Get() {
+			return std::make_tuple(Field("scale", &test::LabelComponent::scale));
+		}
+	};
+
+	namespace test {
+
+		static_assert(MySharedSettings::IsShared<MeshInfo>() && !MySharedSettings::IsComponent<MeshInfo>(), "");
+		static_assert(MyDenseSettings::IsDense<HealthComponent>() && !MyDenseSettings::IsDense<PositionComponent>(), "");
+		static_assert(sizeof(CompactEntity) == 4, "");
+		static_assert(std::is_same<TEntitySystem<MyCompactSettings>::Entity, CompactEntity>::value, "");
+		static_assert(!std::is_copy_constructible<ComponentPool<PositionComponent>>::value && std::is_move_constructible<ComponentPool<PositionComponent>>::value, "");
+		static_assert(!std::is_copy_constructible<TEntitySystem<MySettings>>::value, "");
+
+		static_assert(MySingletonSettings::SingletonCount == 2, "");
+		static_assert(MySingletonSettings::IsSingleton<Gravity>(), "");
+		static_assert(!MySettings::IsSingleton<Gravity>(), "");
+
+		static_assert(MySettings::ComponentCount == 3, "");
+		static_assert(MySettings::TagCount == 3, "");
+		static_assert(MySettings::SignatureCount == 4, "");
+
+		static_assert(MySettings::ComponentId<PositionComponent>() == 0, "");
+		static_assert(MySettings::ComponentId<HealthComponent>() == 1, "");
+		static_assert(MySettings::ComponentId<RenderableComponent>() == 2, "");
+
+		static_assert(MySettings::TagId<T0>() == 0, "");
+		static_assert(MySettings::TagId<T1>() == 1, "");
+		static_assert(MySettings::TagId<T2>() == 2, "");
+
+		static_assert(MySettings::SignatureId<S0>() == 0, "");
+		static_assert(MySettings::SignatureId<S1>() == 1, "");
+		static_assert(MySettings::SignatureId<S2>() == 2, "");
+		static_assert(MySettings::SignatureId<S3>() == 3, "");
+
+		using MySignatureBitset = typename MySettings::SignatureBitset;
+
+		static_assert(std::is_same
+			<
+			MySignatureBitset::SignatureComponents<S0>,
+			Refl::TypeList<>
+			>::value, "");
+
+		static_assert(std::is_same
+			<
+			MySignatureBitset::SignatureComponents<S3>,
+			Refl::TypeList<HealthComponent, RenderableComponent>
+			>::value, "");
+
+		static_assert(std::is_same
+			<
+			MySignatureBitset::SignatureTags<S3>,
+			Refl::TypeList<T0, T2>
+			>::value, "");
+
+		void RuntimeTests() {
+			using Bitset = typename MySignatureBitset::Bitset;
+			Sig::SignatureBitsetStorage<MySettings> msb;
+
+			const auto& bS0(msb.GetSignatureBitset<S0>());
+			const auto& bS1(msb.GetSignatureBitset<S1>());
+			const auto& bS2(msb.GetSignatureBitset<S2>());
+			const auto& bS3(msb.GetSignatureBitset<S3>());
+
+			assert(bS0 == Bitset{ "000000" });
+			assert(bS1 == Bitset{ "000011" });
+			assert(bS2 == Bitset{ "001101" });
+			assert(bS3 == Bitset{ "101110" });
+
+			std::cout << "Signature bitset tests passed!" << std::endl;
+
+			using EntitySystem = TEntitySystem<MySettings>;
+			using EntityPrototype = TEntityPrototype<MySettings>;
+
+			EntitySystem entitySystem;
+
+			// Test component insertion, modification, and deletion
+
+			Entity e = entitySystem.CreateEntity();
+
+			PositionComponent p0;
+			p0.x = 12;
+			p0.y = 32;
+			p0.z = 50;
+
+			entitySystem.AddComponent(e, p0);
+
+			PositionComponent& p1 = entitySystem.GetComponent<PositionComponent>(e);
+			assert(p1.x == 12 && p1.y == 32 && p1.z == 50);
+
+			p1.y = 101;
+
+			PositionComponent& p2 = entitySystem.GetComponent<PositionComponent>(e);
+			assert(p2.x == 12 && p2.y == 101 && p2.z == 50);
+
+			bool removed = entitySystem.RemoveComponent<PositionComponent>(e);
+			assert(removed);
+
+			std::cout << "Component insertion, modification, and deletion tests passed!" << std::endl;
+
+			// Test removal of entity
+
+			Entity e1 = entitySystem.CreateEntity();
+			Entity e2 = entitySystem.CreateEntity();
+			entitySystem.AddComponent(e2, p0);
+			Entity e3 = entitySystem.CreateEntity();
+			Entity e4 = entitySystem.CreateEntity();
+			entitySystem.AddComponent(e4, p0);
+
+			entitySystem.Kill(e2);
+			entitySystem.Refresh();
+
+			assert(entitySystem.IsHandleValid(e2) == false);
+
+			PositionComponent& p4 = entitySystem.GetComponent<PositionComponent>(e4);
+			assert(p4.x == 12 && p4.y == 32 && p4.z == 50);
+
+			std::cout << "Entity removal tests passed!" << std::endl;
+
+			// Check signature matching
+
+			Entity e5 = entitySystem.CreateEntity();
+			entitySystem.AddComponent(e5, PositionComponent());
+			entitySystem.AddComponent(e5, HealthComponent());
+			entitySystem.AddComponent(e5, p0);
+			entitySystem.Refresh();
+			assert(entitySystem.MatchesSignature<S0>(e5));
+			assert(entitySystem.MatchesSignature<S1>(e5));
+			assert(entitySystem.MatchesSignature<S2>(e5) == false);
+			assert(entitySystem.MatchesSignature<S3>(e5) == false);
+
+			std::cout << "Signature matching tests passed!" << std::endl;
+
+			// Entity iteration
+
+			entitySystem.ForEntitiesMatching<S1>([](EntityIndex i, PositionComponent& c1, HealthComponent& c2) {
+				std::cout << "entity " << i << std::endl;
+			});
+
+			// Test entity prototype generation
+
+			EntitySystem system;
+
+			std::string entityData =
+				"{\
+				\"entities\": {\
+					\"cow\": {\
+						\"healthComponent\": {\
+							\"health\": 40,\
+							\"maxHealth\": 50\
+						},\
+						\"positionComponent\": {\
+							\"x\": 5,\
+							\"y\": 10,\
+							\"z\": 15\
+						}\
+					}\
+				}\
+			}";
+			std::istringstream inputStream(entityData, std::istream::binary);
+			Json::Value root;
+			Json::Reader reader;
+			bool success = reader.parse(inputStream, root, false);
+			if (!success) {
+				std::cout << reader.getFormattedErrorMessages() << std::endl;
+			}
+			root = root.get("entities", "");
+			std::vector<EntityPrototype> entityTypes = EntityParser::ParseTypes<MySettings>(root);
+
+			for (std::size_t i = 0; i < entityTypes.size(); ++i) {
+				EntityPrototype& type = entityTypes[i];
+
+				Entity e = type.CreateEntity(system);
+
+				std::cout << type.GetName() << " should have component #0, #1" << std::endl;
+				MyComponentList::ForTypes([&system, &e](auto t) {
+					if (system.HasComponent<TYPE_OF(t)>(e)) {
+						std::cout << "  has component #" << MySettings::ComponentBit<TYPE_OF(t)>() << std::endl;
+					}
+				});
+
+			}
+
+			// Test profiling instrumentation
+
+			TEntitySystem<MyProfiledSettings> profiledSystem;
+			for (int i = 0; i < 4; ++i) {
+				Entity pe = profiledSystem.CreateEntity();
+				profiledSystem.AddComponent(pe, PositionComponent());
+				if (i % 2 == 0) {
+					profiledSystem.AddComponent(pe, HealthComponent());
+				}
+			}
+			profiledSystem.Refresh();
+			profiledSystem.ForEntitiesMatching<S1>([](EntityIndex, PositionComponent&, HealthComponent&) {});
+			profiledSystem.ForChunks<S1, 16>([](TSpan<const EntityIndex>, TSpan<PositionComponent>, TSpan<HealthComponent>) {});
+			profiledSystem.Refresh();
+
+			const auto& frames = profiledSystem.GetProfiler().GetFrames();
+			assert(frames.size() == 2);
+			assert(frames[0].changes.created == 4);
+			assert(frames[0].changes.componentsAdded == 6);
+			const QueryStats& s1Stats = frames[1].queries[MySettings::SignatureId<S1>()];
+			assert(s1Stats.calls == 2 && s1Stats.scanned == 8 && s1Stats.matched == 4);
+
+			std::ostringstream trace;
+			profiledSystem.GetProfiler().WriteChromeTrace(trace);
+			assert(trace.str().find("ForEntitiesMatching[S1]") != std::string::npos);
+			assert(trace.str().find("ForChunks[S1]") != std::string::npos);
+
+			// Stats tooling compiles against an unprofiled world as well
+			EntitySystem unprofiledSystem;
+			unprofiledSystem.GetProfiler().SetFrameHistory(10);
+			unprofiledSystem.Refresh();
+			unprofiledSystem.GetProfiler().Clear();
+			assert(unprofiledSystem.GetProfiler().GetFrames().empty());
+			assert(unprofiledSystem.GetProfiler().GetCurrentFrame().changes.created == 0);
+
+			std::cout << "Profiling tests passed!" << std::endl;
+
+			// Test memory accounting and shrinking
+
+			EntitySystem memorySystem;
+			std::vector<Entity> memoryEntities;
+			for (std::size_t i = 0; i < 3 * COMPONENT_POOL_SIZE; ++i) {
+				Entity me = memorySystem.CreateEntity();
+				memorySystem.AddComponent(me, PositionComponent());
+				memoryEntities.push_back(me);
+			}
+			auto memoryBefore = memorySystem.MemoryStats();
+			assert(memoryBefore.components[0].live == 3 * COMPONENT_POOL_SIZE);
+			assert(memoryBefore.components[0].slots == 3 * COMPONENT_POOL_SIZE);
+			assert(memoryBefore.components[1].reservedBytes == 0);
+
+			for (std::size_t i = COMPONENT_POOL_SIZE; i < memoryEntities.size(); ++i) {
+				memorySystem.Kill(memoryEntities[i]);
+			}
+			memorySystem.Refresh();
+			memorySystem.ShrinkToFit();
+
+			auto memoryAfter = memorySystem.MemoryStats();
+			assert(memoryAfter.components[0].live == COMPONENT_POOL_SIZE);
+			assert(memoryAfter.components[0].reservedBytes < memoryBefore.components[0].reservedBytes);
+			assert(memoryAfter.entityCapacity == COMPONENT_POOL_SIZE);
+			assert(memoryAfter.TotalBytes() < memoryBefore.TotalBytes());
+			assert(memorySystem.HasComponent<PositionComponent>(memoryEntities[0]));
+
+			Entity regrown = memorySystem.CreateEntity();
+			memorySystem.AddComponent(regrown, PositionComponent());
+			assert(memorySystem.MemoryStats().components[0].live == COMPONENT_POOL_SIZE + 1);
+
+			std::cout << "Memory accounting tests passed!" << std::endl;
+
+			// Test allocating a world and its prototypes from an arena
+
+			ArenaResource arena(64 * 1024);
+			{
+				TEntitySystem<MyArenaSettings> arenaSystem(&arena);
+				std::size_t baseline = arena.BytesAllocated();
+				assert(baseline > 0);
+
+				TEntityPrototype<MyArenaSettings> arenaCow("cow", &arena);
+				arenaCow.Add(p0);
+				Entity ae = arenaCow.CreateEntity(arenaSystem);
+				assert(arenaSystem.GetComponent<PositionComponent>(ae).y == 32);
+				assert(arena.BytesAllocated() > baseline);
+
+				std::size_t beforeGrid = arena.BytesAllocated();
+				TSpatialHashGrid<MyArenaSettings, PositionComponent> arenaGrid(8.0f, &arena);
+				arenaSystem.Refresh();
+				arenaGrid.Update(arenaSystem);
+				assert(arenaGrid.Size() == 1);
+				assert(arena.BytesAllocated() > beforeGrid);
+			}
+			arena.Release();
+			assert(arena.BytesAllocated() == 0);
+
+			std::cout << "Allocator tests passed!" << std::endl;
+
+			// Test parent/child relationships
+
+			EntitySystem sceneSystem;
+			Entity ship = sceneSystem.CreateEntity();
+			Entity turret = sceneSystem.CreateEntity();
+			Entity barrel = sceneSystem.CreateEntity();
+			Entity bystander = sceneSystem.CreateEntity();
+
+			PositionComponent offset;
+			offset.x = 1; offset.y = 2; offset.z = 3;
+			sceneSystem.AddComponent(ship, offset);
+			sceneSystem.AddComponent(turret, offset);
+			sceneSystem.AddComponent(barrel, offset);
+
+			sceneSystem.SetParent(barrel, turret);
+			sceneSystem.SetParent(turret, ship);
+			assert(sceneSystem.GetParent(barrel) == turret);
+			assert(sceneSystem.ChildCount(ship) == 1);
+			assert(sceneSystem.IsDescendantOf(barrel, ship));
+
+			const auto& order = sceneSystem.HierarchyOrder();
+			assert(order.size() == 3);
+			assert(order[0].entity == ship && order[0].parent == HierarchyNode::NoParent);
+			assert(order[2].entity == barrel && order[2].depth == 2);
+
+			std::vector<float> worldX(order.size());
+			for (std::size_t i = 0; i < order.size(); ++i) {
+				float parentX = order[i].parent == HierarchyNode::NoParent ? 0.0f : worldX[order[i].parent];
+				worldX[i] = parentX + sceneSystem.GetComponent<PositionComponent>(order[i].entity).x;
+			}
+			assert(worldX[2] == 3);
+
+			sceneSystem.Kill(ship);
+			sceneSystem.Refresh();
+			assert(!sceneSystem.IsHandleValid(ship));
+			assert(!sceneSystem.IsHandleValid(turret));
+			assert(!sceneSystem.IsHandleValid(barrel));
+			assert(sceneSystem.IsHandleValid(bystander));
+			assert(sceneSystem.HierarchyOrder().empty());
+
+			std::cout << "Hierarchy tests passed!" << std::endl;
+
+			// Test spatial index queries and change detection
+
+			EntitySystem spatialSystem;
+			std::vector<Entity> spatialEntities;
+			for (int i = 0; i < 10; ++i) {
+				Entity se = spatialSystem.CreateEntity();
+				PositionComponent sp;
+				sp.x = float(i * 10); sp.y = 0; sp.z = 0;
+				spatialSystem.AddComponent(se, sp);
+				spatialEntities.push_back(se);
+			}
+			spatialSystem.Refresh();
+
+			TSpatialHashGrid<MySettings, PositionComponent> grid(8.0f);
+			grid.Update(spatialSystem);
+			assert(grid.Size() == 10 && grid.LastUpdateRebuilt());
+
+			std::vector<EntityIndex> nearby;
+			grid.QueryRadius(20, 0, 0, 10.5f, nearby);
+			assert(nearby.size() == 3);
+
+			spatialSystem.GetComponent<PositionComponent>(spatialEntities[9]).x = 21;
+			grid.Update(spatialSystem);
+			assert(!grid.LastUpdateRebuilt());
+
+			nearby.clear();
+			grid.QueryAABB(15, -1, -1, 25, 1, 1, nearby);
+			assert(nearby.size() == 2);
+
+			spatialSystem.Kill(spatialEntities[2]);
+			spatialSystem.Refresh();
+			grid.Update(spatialSystem);
+			assert(grid.Size() == 9);
+			nearby.clear();
+			grid.QueryRadius(20, 0, 0, 1.5f, nearby);
+			assert(nearby.size() == 1 && spatialSystem.GetEntity(nearby[0]) == spatialEntities[9]);
+
+			// Marked updates touch only the marked entities, empty cells are
+			// dropped and indices are looked up at query time
+			std::size_t cellsBefore = grid.CellCount();
+			spatialSystem.GetComponent<PositionComponent>(spatialEntities[9]).x = 90;
+			grid.MarkMoved(spatialEntities[9]);
+			Entity spatialNewcomer = spatialSystem.CreateEntity();
+			PositionComponent farAway;
+			farAway.x = 1e30f; farAway.y = -std::numeric_limits<float>::infinity(); farAway.z = std::nanf("");
+			spatialSystem.AddComponent(spatialNewcomer, farAway);
+			grid.MarkMoved(spatialNewcomer);
+			spatialSystem.Kill(spatialEntities[0]);
+			spatialSystem.Refresh();
+			grid.MarkMoved(spatialEntities[0]);
+			grid.UpdateMarked(spatialSystem);
+			assert(grid.Size() == 9 && !grid.LastUpdateRebuilt());
+			assert(grid.CellCount() == cellsBefore);
+
+			nearby.clear();
+			grid.QueryRadius(90, 0, 0, 10.5f, nearby);
+			assert(nearby.size() == 2);
+			for (EntityIndex index : nearby) {
+				Entity found = spatialSystem.GetEntity(index);
+				assert(found == spatialEntities[8] || found == spatialEntities[9]);
+			}
+
+			const float infinity = std::numeric_limits<float>::infinity();
+			std::size_t everything = 0;
+			grid.QueryRadius(0, 0, 0, infinity, [&everything](Entity, EntityIndex) { ++everything; });
+			assert(everything == 8);
+			nearby.clear();
+			grid.QueryAABB(-infinity, -infinity, -infinity, infinity, infinity, infinity, nearby);
+			assert(nearby.size() == 8);
+
+			for (Entity se : spatialEntities) {
+				if (!spatialSystem.IsHandleValid(se)) continue;
+				spatialSystem.GetComponent<PositionComponent>(se).x = 0;
+				grid.MarkMoved(se);
+			}
+			spatialSystem.RemoveComponent<PositionComponent>(spatialNewcomer);
+			grid.MarkMoved(spatialNewcomer);
+			grid.UpdateMarked(spatialSystem);
+			assert(grid.Size() == 8 && grid.CellCount() == 1);
+
+			std::cout << "Spatial index tests passed!" << std::endl;
+
+			// Test sorting component storage
+
+			EntitySystem renderSystem;
+			std::vector<Entity> renderEntities;
+			for (int meshId : { 3, 1, 2, 1, 3, 0 }) {
+				Entity re = renderSystem.CreateEntity();
+				RenderableComponent renderable;
+				renderable.meshId = meshId;
+				renderSystem.AddComponent(re, renderable);
+				renderEntities.push_back(re);
+			}
+			renderSystem.RemoveComponent<RenderableComponent>(renderEntities[5]);
+			renderSystem.Refresh();
+
+			auto byMesh = [](const RenderableComponent& a, const RenderableComponent& b) { return a.meshId < b.meshId; };
+			renderSystem.SortComponents<RenderableComponent>(byMesh, ComponentSortMode::Full, true);
+
+			std::vector<int> meshOrder;
+			renderSystem.ForEachComponent<RenderableComponent>([&meshOrder](Entity, RenderableComponent& r) {
+				meshOrder.push_back(r.meshId);
+			});
+			assert((meshOrder == std::vector<int>{ 1, 1, 2, 3, 3 }));
+			assert(renderSystem.GetComponent<RenderableComponent>(renderEntities[2]).meshId == 2);
+			assert(renderSystem.GetComponent<RenderableComponent>(renderSystem.GetEntity(0)).meshId == 1);
+			assert(renderSystem.GetEntity(5) == renderEntities[5]);
+
+			renderSystem.GetComponent<RenderableComponent>(renderEntities[0]).meshId = 0;
+			renderSystem.SortComponents<RenderableComponent>(byMesh, ComponentSortMode::Insertion);
+			meshOrder.clear();
+			renderSystem.ForEachComponent<RenderableComponent>([&meshOrder](Entity, RenderableComponent& r) {
+				meshOrder.push_back(r.meshId);
+			});
+			assert((meshOrder == std::vector<int>{ 0, 1, 1, 2, 3 }));
+
+			std::cout << "Component sorting tests passed!" << std::endl;
+
+			// Test chunked iteration
+
+			EntitySystem chunkSystem;
+			std::vector<Entity> chunkEntities;
+			for (int i = 0; i < 10; ++i) {
+				chunkEntities.push_back(chunkSystem.CreateEntity());
+			}
+			// Positions are stored in reverse entity order and gathered per
+			// chunk, healths are consecutive and passed in place
+			for (int i = 9; i >= 0; --i) {
+				PositionComponent position;
+				position.x = float(i);
+				chunkSystem.AddComponent(chunkEntities[i], position);
+			}
+			for (int i = 0; i < 10; ++i) {
+				if (i == 7) continue;
+				HealthComponent health;
+				health.health = float(i * 10);
+				chunkSystem.AddComponent(chunkEntities[i], health);
+			}
+			chunkSystem.Refresh();
+
+			std::vector<std::size_t> chunkSizes;
+			chunkSystem.ForChunks<S1, 4>([&chunkSizes](TSpan<const EntityIndex> indices, TSpan<PositionComponent> positions, TSpan<HealthComponent> healths) {
+				assert(indices.size() == positions.size() && indices.size() == healths.size());
+				chunkSizes.push_back(indices.size());
+				for (std::size_t i = 0; i < positions.size(); ++i) {
+					positions[i].x += healths[i].health;
+					healths[i].health = 1;
+				}
+			});
+			assert((chunkSizes == std::vector<std::size_t>{ 4, 4, 1 }));
+			for (int i = 0; i < 10; ++i) {
+				const PositionComponent& position = chunkSystem.GetComponent<PositionComponent>(chunkEntities[i]);
+				assert(position.x == (i == 7 ? 7.0f : float(i * 11)));
+				if (i != 7) {
+					assert(chunkSystem.GetComponent<HealthComponent>(chunkEntities[i]).health == 1);
+				}
+			}
+
+			// Storage consecutive in entity order is passed in place, with
+			// chunks ending at pool page boundaries
+
+			EntitySystem pagedChunkSystem;
+			std::vector<Entity> pagedChunkEntities;
+			for (std::size_t i = 0; i < COMPONENT_POOL_SIZE + 100; ++i) {
+				Entity ce = pagedChunkSystem.CreateEntity();
+				PositionComponent position;
+				position.x = float(i);
+				pagedChunkSystem.AddComponent(ce, position);
+				pagedChunkSystem.AddComponent(ce, HealthComponent());
+				pagedChunkEntities.push_back(ce);
+			}
+			pagedChunkSystem.Refresh();
+
+			std::vector<std::size_t> pagedChunkSizes;
+			pagedChunkSystem.ForChunks<S1, 300>([&](TSpan<const EntityIndex> indices, TSpan<PositionComponent> positions, TSpan<HealthComponent> healths) {
+				Entity first = pagedChunkSystem.GetEntity(indices[0]);
+				assert(positions.data() == &pagedChunkSystem.GetComponent<PositionComponent>(first));
+				assert(healths.data() == &pagedChunkSystem.GetComponent<HealthComponent>(first));
+				pagedChunkSizes.push_back(indices.size());
+			});
+			assert((pagedChunkSizes == std::vector<std::size_t>{ 300, 300, 300, COMPONENT_POOL_SIZE - 900, 100 }));
+
+			std::cout << "Chunked iteration tests passed!" << std::endl;
+
+			// Test singletons
+
+			TEntitySystem<MySingletonSettings> singletonSystem;
+			assert(singletonSystem.GetSingleton<Gravity>().value == -9.8f);
+			singletonSystem.GetSingleton<GameClock>().frame = 3;
+			singletonSystem.SetSingleton(Gravity{ -1.6f });
+
+			Entity falling = singletonSystem.CreateEntity();
+			singletonSystem.AddComponent(falling, PositionComponent());
+			singletonSystem.GetComponent<PositionComponent>(falling).z = 10;
+			singletonSystem.Refresh();
+
+			const Gravity& gravity = singletonSystem.GetSingleton<Gravity>();
+			singletonSystem.ForEntities([&](EntityIndex index) {
+				singletonSystem.GetComponent<PositionComponent>(singletonSystem.GetEntity(index)).z += gravity.value;
+			});
+			assert(singletonSystem.GetComponent<PositionComponent>(falling).z == 10 - 1.6f);
+
+			singletonSystem.Clear();
+			assert(singletonSystem.GetSingleton<GameClock>().frame == 3);
+
+			std::cout << "Singleton tests passed!" << std::endl;
+
+			// Test bulk tags and tag column queries
+
+			EntitySystem tagSystem;
+			std::vector<Entity> tagEntities;
+			for (int i = 0; i < 200; ++i) {
+				tagEntities.push_back(tagSystem.CreateEntity());
+			}
+			tagSystem.Refresh();
+
+			tagSystem.AddTags<T0>(10, 150);
+			tagSystem.AddTags<T1>(100, 200);
+			tagSystem.RemoveTags<T0>(64, 70);
+			assert(tagSystem.HasTag<T0>(tagEntities[10]) && !tagSystem.HasTag<T0>(tagEntities[64]));
+			assert(tagSystem.CountTagged<T0>() == 134);
+			assert(tagSystem.CountTagged<T1>() == 100);
+			assert((tagSystem.CountTagged<T0, T1>() == 50));
+			assert(tagSystem.CountTagged<T2>() == 0);
+
+			std::vector<EntityIndex> tagged;
+			tagSystem.ForEntitiesTagged<T0, T1>([&tagged](EntityIndex index) { tagged.push_back(index); });
+			assert(tagged.size() == 50 && tagged.front() == 100 && tagged.back() == 149);
+
+			tagSystem.AddTags<T2>(tagged);
+			tagSystem.RemoveTag<T2>(tagEntities[120]);
+			assert(tagSystem.CountTagged<T2>() == 49);
+
+			// Tag columns follow entities when Refresh() compacts the array
+			for (int i = 0; i < 100; ++i) {
+				tagSystem.Kill(tagEntities[i]);
+			}
+			tagSystem.Refresh();
+			assert(tagSystem.CountTagged<T0>() == 50);
+			assert(tagSystem.CountTagged<T1>() == 100);
+			assert(tagSystem.CountTagged<T2>() == 49);
+			tagSystem.ForEntitiesTagged<T2>([&](EntityIndex index) {
+				assert(tagSystem.HasTag<T2>(index) && tagSystem.HasTag<T0>(index));
+				assert(tagSystem.GetEntity(index) != tagEntities[120]);
+			});
+
+			std::cout << "Tag column tests passed!" << std::endl;
+
+			// Test event queues
+
+			TEntitySystem<MyEventSettings> eventSystem;
+			Entity target = eventSystem.CreateEntity();
+			eventSystem.AddComponent(target, HealthComponent());
+			eventSystem.GetComponent<HealthComponent>(target).health = 10000;
+			eventSystem.Refresh();
+
+			std::vector<std::thread> producers;
+			for (int t = 0; t < 4; ++t) {
+				producers.emplace_back([&eventSystem, target]() {
+					for (int i = 0; i < 100; ++i) {
+						eventSystem.EmitEvent(DamageEvent{ target, 1 });
+					}
+				});
+			}
+			for (std::thread& producer : producers) {
+				producer.join();
+			}
+			assert(eventSystem.ReadEvents<DamageEvent>().empty());
+			assert(eventSystem.GetEventQueue<DamageEvent>().Pending() == 400);
+
+			eventSystem.Refresh();
+			assert(eventSystem.ReadEvents<DamageEvent>().size() == 400);
+			assert(eventSystem.GetEventQueue<DamageEvent>().Capacity() >= 400);
+			for (const DamageEvent& damage : eventSystem.ReadEvents<DamageEvent>()) {
+				eventSystem.GetComponent<HealthComponent>(damage.target).health -= damage.amount;
+			}
+			assert(eventSystem.GetComponent<HealthComponent>(target).health == 9600);
+
+			eventSystem.EmitEvent(DamageEvent{ target, 5 });
+			eventSystem.Refresh();
+			assert(eventSystem.ReadEvents<DamageEvent>().size() == 1 && eventSystem.ReadEvents<DamageEvent>()[0].amount == 5);
+			eventSystem.Refresh();
+			assert(eventSystem.ReadEvents<DamageEvent>().empty());
+
+			// Clear() drops readable and pending events alike
+			eventSystem.EmitEvent(DamageEvent{ target, 1 });
+			eventSystem.Refresh();
+			eventSystem.EmitEvent(DamageEvent{ target, 2 });
+			eventSystem.Clear();
+			assert(eventSystem.ReadEvents<DamageEvent>().empty());
+			eventSystem.Refresh();
+			assert(eventSystem.ReadEvents<DamageEvent>().empty());
+
+			// Queues sharing an arena overflow into it through one lock
+			ArenaResource queueArena(4096);
+			LockedResource lockedQueueArena(&queueArena);
+			using ArenaQueue = TEventQueue<DamageEvent, TResourceAllocator<DamageEvent>>;
+			ArenaQueue arenaQueues[2] = {
+				ArenaQueue(TResourceAllocator<DamageEvent>(&queueArena), 4, &lockedQueueArena),
+				ArenaQueue(TResourceAllocator<DamageEvent>(&queueArena), 4, &lockedQueueArena)
+			};
+			const std::size_t queueBytes = queueArena.BytesAllocated();
+			std::vector<std::thread> overflowing;
+			for (int t = 0; t < 4; ++t) {
+				overflowing.emplace_back([&arenaQueues, target, t]() {
+					for (int i = 0; i < 50; ++i) {
+						arenaQueues[t % 2].Emit(DamageEvent{ target, 1 });
+					}
+				});
+			}
+			for (std::thread& producer : overflowing) {
+				producer.join();
+			}
+			assert(queueArena.BytesAllocated() > queueBytes);
+			for (ArenaQueue& arenaQueue : arenaQueues) {
+				arenaQueue.Swap();
+				assert(arenaQueue.Read().size() == 100);
+			}
+
+			std::cout << "Event queue tests passed!" << std::endl;
+
+			// Test concurrent entity reservation
+
+			EntitySystem spawnSystem;
+			Entity spawner = spawnSystem.CreateEntity();
+			std::vector<std::vector<Entity>> spawned(4);
+			std::vector<std::thread> workers;
+			for (std::size_t t = 0; t < spawned.size(); ++t) {
+				workers.emplace_back([&spawnSystem, &spawned, t]() {
+					for (int i = 0; i < 50; ++i) {
+						spawned[t].push_back(spawnSystem.ReserveEntity());
+					}
+					spawnSystem.ReserveEntities(50, spawned[t]);
+				});
+			}
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+
+			std::vector<Entity> reserved;
+			for (const std::vector<Entity>& list : spawned) {
+				reserved.insert(reserved.end(), list.begin(), list.end());
+			}
+			std::sort(reserved.begin(), reserved.end());
+			assert(reserved.size() == 400 && std::unique(reserved.begin(), reserved.end()) == reserved.end());
+			assert(!spawnSystem.IsHandleValid(reserved[0]));
+
+			Entity created = spawnSystem.CreateEntity();
+			assert(std::find(reserved.begin(), reserved.end(), created) == reserved.end());
+
+			spawnSystem.Refresh();
+			std::size_t alive = 0;
+			spawnSystem.ForEntities([&alive](EntityIndex) { ++alive; });
+			assert(alive == 402);
+			for (Entity e : reserved) {
+				assert(spawnSystem.IsHandleValid(e) && spawnSystem.IsAlive(e));
+			}
+			spawnSystem.AddComponent(reserved[7], HealthComponent());
+			assert(spawnSystem.HasComponent<HealthComponent>(reserved[7]));
+			assert(spawnSystem.IsHandleValid(spawner));
+
+			std::cout << "Entity reservation tests passed!" << std::endl;
+
+			// Test per-world ids and compact handles
+
+			EntitySystem worldA, worldB;
+			assert(worldA.CreateEntity() == worldB.CreateEntity());
+
+			TEntitySystem<MyCompactSettings> compactSystem;
+			CompactEntity first = compactSystem.CreateEntity();
+			CompactEntity second = compactSystem.CreateEntity();
+			compactSystem.AddComponent(second, PositionComponent());
+			assert(first.Generation() == 0 && second.Index() == first.Index() + 1);
+
+			compactSystem.Kill(first);
+			compactSystem.Refresh();
+			assert(!compactSystem.IsHandleValid(first));
+
+			CompactEntity reused = compactSystem.CreateEntity();
+			assert(reused.Index() == first.Index() && reused.Generation() == 1 && reused != first);
+			assert(!compactSystem.IsHandleValid(first) && compactSystem.IsHandleValid(reused));
+			assert(compactSystem.HasComponent<PositionComponent>(second));
+
+			compactSystem.Clear();
+			CompactEntity afterClear = compactSystem.CreateEntity();
+			assert(afterClear.Generation() > 0);
+
+			TEntitySystem<MyTinyHandleSettings> tinySystem;
+			std::vector<TinyEntity> tinyHandles;
+			tinySystem.ReserveEntities(std::size_t(TinyEntity::IndexMask), tinyHandles);
+			auto exhausts = [](auto&& reserve) {
+				try {
+					reserve();
+				}
+				catch (const std::length_error&) {
+					return true;
+				}
+				return false;
+			};
+			assert(exhausts([&tinySystem]() { tinySystem.ReserveEntity(); }));
+			assert(exhausts([&tinySystem]() { tinySystem.CreateEntity(); }));
+			tinySystem.Refresh();
+			assert(tinySystem.IsHandleValid(tinyHandles.front()) && tinySystem.IsHandleValid(tinyHandles.back()));
+
+			tinySystem.Kill(tinyHandles[10]);
+			tinySystem.Kill(tinyHandles[20]);
+			tinySystem.Refresh();
+			std::vector<TinyEntity> recycledHandles;
+			tinySystem.ReserveEntities(2, recycledHandles);
+			assert(recycledHandles[0].Index() == tinyHandles[20].Index() && recycledHandles[1].Index() == tinyHandles[10].Index());
+			assert(recycledHandles[0].Generation() == 1 && exhausts([&tinySystem]() { tinySystem.ReserveEntity(); }));
+			tinySystem.Refresh();
+			assert(tinySystem.IsHandleValid(recycledHandles[1]) && !tinySystem.IsHandleValid(tinyHandles[10]));
+
+			std::cout << "Compact handle tests passed!" << std::endl;
+
+			// Test columnar component import
+
+			Json::Value levelRoot;
+			Json::Reader levelReader;
+			levelReader.parse(R"({
+				"count": 4,
+				"components": {
+					"positionComponent": { "x": [0, 1, 2, 3], "y": [0.5, 1.5, 2.5, 3.5], "z": [0, 0, 0, 0] },
+					"healthComponent": { "rows": [1, 3], "health": [50, 75], "maxHealth": [100, 100], "armor": [1, 2] }
+				}
+			})", levelRoot);
+
+			ColumnarBatch level;
+			ColumnarImportReport levelReport;
+			assert(EntityParser::ParseColumns(levelRoot, level, levelReport));
+
+			EntitySystem levelSystem;
+			std::vector<Entity> loaded;
+			assert(EntityParser::ImportColumns(levelSystem, level, levelReport, &loaded));
+			assert(loaded.size() == 4 && levelReport.entities == 4 && levelReport.components == 2);
+			assert(levelReport.warnings.size() == 1);
+			assert(levelSystem.GetComponent<PositionComponent>(loaded[2]).y == 2.5f);
+			assert(!levelSystem.HasComponent<HealthComponent>(loaded[0]));
+			assert(levelSystem.GetComponent<HealthComponent>(loaded[3]).health == 75);
+
+			std::stringstream levelBinary;
+			EntityParser::WriteColumnsBinary(levelBinary, level);
+			ColumnarBatch levelCopy;
+			ColumnarImportReport copyReport;
+			assert(EntityParser::ReadColumnsBinary(levelBinary, levelCopy, copyReport));
+			assert(EntityParser::ImportColumns(levelSystem, levelCopy, copyReport, &loaded));
+			assert(loaded.size() == 8 && levelSystem.GetComponent<HealthComponent>(loaded[5]).maxHealth == 100);
+
+			// Corrupt counts and truncated files are reported, not allocated
+			const std::string levelBytes = levelBinary.str();
+			auto readCorrupt = [](const std::string& bytes) {
+				std::stringstream corrupt(bytes);
+				ColumnarBatch corruptBatch;
+				ColumnarImportReport corruptReport;
+				return !EntityParser::ReadColumnsBinary(corrupt, corruptBatch, corruptReport) && corruptReport.errors.size() == 1;
+			};
+			const std::uint64_t hugeCount = std::numeric_limits<std::uint64_t>::max() / 2;
+			for (std::size_t offset : { std::size_t(8), std::size_t(16), 24 + level.components[0].name.size() }) {
+				std::string corrupt = levelBytes;
+				std::memcpy(&corrupt[offset], &hugeCount, offset == 16 ? sizeof(std::uint32_t) : sizeof(std::uint64_t));
+				assert(readCorrupt(corrupt));
+			}
+			assert(readCorrupt(levelBytes.substr(0, levelBytes.size() / 2)));
+
+			levelRoot["components"]["positionComponent"]["y"].append(4.5);
+			levelRoot["components"]["healthComponent"]["rows"][1] = 9;
+			ColumnarBatch badLevel;
+			ColumnarImportReport badReport;
+			EntityParser::ParseColumns(levelRoot, badLevel, badReport);
+			assert(!EntityParser::ImportColumns(levelSystem, badLevel, badReport));
+			assert(badReport.errors.size() == 2 && loaded.size() == 8);
+
+			// Counts past the handle space are reported before anything is allocated
+			Json::Value hugeRoot;
+			levelReader.parse(R"({ "count": 4294967296, "components": { "healthComponent": { "rows": [0], "health": [1], "maxHealth": [1] } } })", hugeRoot);
+			ColumnarBatch hugeLevel;
+			ColumnarImportReport hugeReport;
+			assert(EntityParser::ParseColumns(hugeRoot, hugeLevel, hugeReport));
+			TEntitySystem<MyCompactSettings> hugeSystem;
+			assert(!EntityParser::ImportColumns(hugeSystem, hugeLevel, hugeReport));
+			assert(hugeReport.errors.size() == 1 && hugeReport.entities == 0);
+
+			// Integers above INT64_MAX keep their value in a UInt64 column
+			Json::Value wideRoot;
+			levelReader.parse(R"({ "count": 2, "components": { "renderableComponent": { "meshId": [1, 18446744073709551615] },
+				"positionComponent": { "x": [-1, 18446744073709551615] } } })", wideRoot);
+			ColumnarBatch wideLevel;
+			ColumnarImportReport wideReport;
+			assert(EntityParser::ParseColumns(wideRoot, wideLevel, wideReport));
+			for (const ColumnarComponent& component : wideLevel.components) {
+				assert(component.columns[0].type == (component.name == "renderableComponent" ? ColumnType::UInt64 : ColumnType::Float64));
+			}
+
+			std::cout << "Columnar import tests passed!" << std::endl;
+
+			// Test the FastJson prototype reader
+
+			FastJson::Document fastDocument;
+			assert(fastDocument.Parse(R"({ "s": "a\"b\u00e9\ud83d\ude00", "n": [-1.5e2, 0.1, 12345678901234567890, true, null], "e": {} })"));
+			FastJson::Value fastRoot = fastDocument.Root();
+			assert(fastRoot["s"].AsString() == "a\"b\xc3\xa9\xf0\x9f\x98\x80");
+			assert(fastRoot["n"].Size() == 5 && fastRoot["n"][0].AsDouble() == -150 && fastRoot["n"][1].AsDouble() == 0.1);
+			assert(fastRoot["n"][2].AsDouble() == 12345678901234567890.0 && fastRoot["n"][3].AsBool() && fastRoot["n"][4].IsNull());
+			assert(fastRoot["e"].IsObject() && fastRoot["e"].Size() == 0 && !fastRoot["missing"]);
+
+			FastJson::Document badDocument;
+			assert(!badDocument.Parse("{ \"a\": [1, 2 }") && !badDocument.GetError().empty());
+
+			FastJson::Document prototypeDocument;
+			assert(prototypeDocument.Parse(entityData));
+			std::vector<EntityPrototype> fastTypes = EntityParser::ParseTypes<MySettings>(prototypeDocument.Root()["entities"]);
+			assert(fastTypes.size() == entityTypes.size() && fastTypes[0].GetName() == "cow");
+			assert(fastTypes[0].Get<HealthComponent>().maxHealth == entityTypes[0].Get<HealthComponent>().maxHealth);
+			assert(fastTypes[0].Get<PositionComponent>().z == 15 && !fastTypes[0].Contains<RenderableComponent>());
+
+			std::cout << "FastJson reader tests passed!" << std::endl;
+
+			// Test prototype inheritance
+
+			std::string inheritedData = R"({
+				"animal": { "healthComponent": { "health": 10, "maxHealth": 20 } },
+				"cow": { "extends": "animal", "positionComponent": { "x": 1, "y": 2, "z": 3 } },
+				"bigCow": { "extends": "cow", "healthComponent": { "maxHealth": 80 } },
+				"rock": { "renderableComponent": { "meshId": 7 } },
+				"ghost": { "extends": "spirit" },
+				"loopA": { "extends": "loopB" },
+				"loopB": { "extends": "loopA" },
+				"loopChild": { "extends": "loopA" },
+				"rock": { "renderableComponent": { "meshId": 8 } }
+			})";
+
+			ThreadPool loadPool(4);
+			std::vector<int> visits(100, 0);
+			loadPool.ParallelFor(visits.size(), [&visits](std::size_t i) { ++visits[i]; });
+			assert(loadPool.ThreadCount() == 4 && std::count(visits.begin(), visits.end(), 1) == 100);
+
+			FastJson::Document inheritedDocument;
+			assert(inheritedDocument.Parse(inheritedData));
+			PrototypeParseReport inheritReport;
+			std::vector<EntityPrototype> inherited = EntityParser::ParseTypes<MySettings>(inheritedDocument.Root(), inheritReport, &loadPool);
+			assert(!inheritReport.Ok() && inheritReport.errors.size() == 4 && inheritReport.prototypes == 4);
+			assert(inherited.size() == 4 && inherited[0].GetName() == "animal" && inherited[2].GetName() == "bigCow");
+			assert(inherited[1].Get<HealthComponent>().maxHealth == 20 && inherited[1].Get<PositionComponent>().y == 2);
+			assert(&inherited[1].Get<HealthComponent>() == &inherited[0].Get<HealthComponent>());
+			assert(inherited[2].Get<HealthComponent>().health == 10 && inherited[2].Get<HealthComponent>().maxHealth == 80);
+			assert(inherited[2].Get<PositionComponent>().z == 3 && inherited[3].Get<RenderableComponent>().meshId == 7);
+
+			Json::Value inheritedRoot;
+			assert(Json::Reader().parse(inheritedData, inheritedRoot, false));
+			PrototypeParseReport jsonInheritReport;
+			std::vector<EntityPrototype> jsonInherited = EntityParser::ParseTypes<MySettings>(inheritedRoot, jsonInheritReport);
+			assert(jsonInherited.size() == 4 && jsonInheritReport.errors.size() == 3);
+			assert(jsonInherited[0].GetName() == "animal" && jsonInherited[1].GetName() == "bigCow");
+			assert(jsonInherited[1].Get<HealthComponent>().maxHealth == 80 && jsonInherited[1].Get<PositionComponent>().x == 1);
+
+			Entity derivedCow = inherited[2].CreateEntity(system);
+			assert(system.GetComponent<HealthComponent>(derivedCow).maxHealth == 80 && system.HasComponent<PositionComponent>(derivedCow));
+
+			std::cout << "Prototype inheritance tests passed!" << std::endl;
+
+			// Test the binary prototype cache
+
+			const std::string basePath = "ecs_test_base.json", variantPath = "ecs_test_variant.json", cachePath = "ecs_test_prototypes.cache";
+			auto writeText = [](const std::string& path, const std::string& text) {
+				std::ofstream(path, std::ios::binary) << text;
+			};
+			writeText(basePath, R"({ "animal": { "healthComponent": { "health": 10, "maxHealth": 20 } },
+				"cow": { "extends": "animal", "positionComponent": { "x": 1, "y": 2, "z": 3 } } })");
+			writeText(variantPath, R"({ "bigCow": { "extends": "cow", "healthComponent": { "maxHealth": 80 } } })");
+			std::remove(cachePath.c_str());
+
+			PrototypeParseReport coldReport;
+			std::vector<EntityPrototype> cold = EntityParser::LoadPrototypes<MySettings>({ basePath, variantPath }, cachePath, coldReport, &loadPool);
+			assert(coldReport.Ok() && coldReport.warnings.empty() && !coldReport.fromCache && cold.size() == 3);
+
+			PrototypeParseReport warmReport;
+			std::vector<EntityPrototype> warm = EntityParser::LoadPrototypes<MySettings>({ basePath, variantPath }, cachePath, warmReport);
+			assert(warmReport.fromCache && warm.size() == 3 && warm[2].GetName() == "bigCow");
+			assert(warm[2].Get<HealthComponent>().health == 10 && warm[2].Get<HealthComponent>().maxHealth == 80);
+			assert(warm[1].Get<PositionComponent>().z == 3 && !warm[0].Contains<PositionComponent>());
+
+			// Cached prototypes equal the parsed ones field by field
+			assert(warm.size() == cold.size());
+			for (std::size_t p = 0; p < cold.size(); ++p) {
+				assert(warm[p].GetName() == cold[p].GetName());
+				MyComponentList::ForTypes([&](auto t) {
+					using ComponentType = TYPE_OF(t);
+					assert(warm[p].Contains<ComponentType>() == cold[p].Contains<ComponentType>());
+					if (!cold[p].Contains<ComponentType>()) return;
+					EntityParser::detail::forEachField(ComponentFields<ComponentType>::Get(), [&](const auto& field) {
+						assert(warm[p].Get<ComponentType>().*field.member == cold[p].Get<ComponentType>().*field.member);
+						(void)field;
+					});
+				});
+			}
+
+			writeText(variantPath, R"({ "bigCow": { "extends": "cow", "healthComponent": { "maxHealth": 90 } } })");
+			PrototypeParseReport staleReport;
+			std::vector<EntityPrototype> stale = EntityParser::LoadPrototypes<MySettings>({ basePath, variantPath }, cachePath, staleReport);
+			assert(!staleReport.fromCache && stale[2].Get<HealthComponent>().maxHealth == 90);
+
+			writeText(cachePath, "ECSP");
+			PrototypeParseReport corruptReport;
+			assert(EntityParser::LoadPrototypes<MySettings>({ basePath, variantPath }, cachePath, corruptReport).size() == 3 && !corruptReport.fromCache);
+
+			writeText(variantPath, R"({ "bag": { "inventoryComponent": {} }, "crate": { "positionComponent": { "x": 1, "y": 2, "z": 3 } } })");
+			std::remove(cachePath.c_str());
+			PrototypeParseReport undescribedReport;
+			EntityParser::LoadPrototypes<MyInventorySettings>({ variantPath }, cachePath, undescribedReport);
+			assert(undescribedReport.Ok() && undescribedReport.warnings.size() == 1);
+			assert(EntityParser::LoadPrototypes<MyInventorySettings>({ variantPath }, cachePath, undescribedReport).size() == 2 && !undescribedReport.fromCache);
+
+			writeText(variantPath, R"({ "sign": { "labelComponent": { "text": "exit", "scale": 2 } } })");
+			std::remove(cachePath.c_str());
+			PrototypeParseReport partialReport;
+			EntityParser::LoadPrototypes<MyLabelSettings>({ variantPath }, cachePath, partialReport);
+			assert(partialReport.Ok() && partialReport.warnings.size() == 1);
+			std::vector<TEntityPrototype<MyLabelSettings>> signs = EntityParser::LoadPrototypes<MyLabelSettings>({ variantPath }, cachePath, partialReport);
+			assert(!partialReport.fromCache && signs.size() == 1);
+			assert(signs[0].Get<LabelComponent>().text == "exit" && signs[0].Get<LabelComponent>().scale == 2);
+
+			std::remove(basePath.c_str());
+			std::remove(variantPath.c_str());
+			std::remove(cachePath.c_str());
+
+			std::cout << "Prototype cache tests passed!" << std::endl;
+
+			// Test parallel loading of several prototype files
+
+			std::vector<std::string> prototypePaths;
+			for (int f = 0; f < 8; ++f) {
+				std::string text = "{";
+				for (int p = 0; p < 20; ++p) {
+					const int id = f * 20 + p;
+					text += (p ? ", " : " ") + std::string("\"type") + std::to_string(id) + "\": { ";
+					text += p % 4 ? "\"extends\": \"type" + std::to_string(id - p % 4) + "\", " : "";
+					text += "\"healthComponent\": { \"health\": " + std::to_string(id) + ", \"maxHealth\": 100 } }";
+				}
+				text += f == 7 ? ", \"type3\": { \"healthComponent\": { \"health\": 0, \"maxHealth\": 0 } } }" : " }";
+				prototypePaths.push_back("ecs_test_prototypes" + std::to_string(f) + ".json");
+				writeText(prototypePaths.back(), text);
+			}
+
+			PrototypeParseReport serialReport, parallelReport;
+			std::vector<EntityPrototype> serial = EntityParser::LoadPrototypes<MySettings>(prototypePaths, "", serialReport);
+			std::vector<EntityPrototype> parallel = EntityParser::LoadPrototypes<MySettings>(prototypePaths, "", parallelReport, &loadPool);
+			assert(serial.size() == 160 && parallel.size() == 160);
+			assert(parallelReport.errors == serialReport.errors && parallelReport.errors.size() == 1);
+			assert(parallelReport.errors[0] == "ecs_test_prototypes7.json: type3: duplicate prototype, first defined in ecs_test_prototypes0.json");
+			for (std::size_t i = 0; i < parallel.size(); ++i) {
+				assert(parallel[i].GetName() == "type" + std::to_string(i) && serial[i].GetName() == parallel[i].GetName());
+				assert(parallel[i].Get<HealthComponent>().health == float(i));
+			}
+
+			PrototypeParseReport missingReport;
+			assert(EntityParser::LoadPrototypes<MySettings>({ "ecs_test_missing.json" }, "", missingReport, &loadPool).empty());
+			assert(missingReport.errors.size() == 1);
+
+			for (const std::string& path : prototypePaths) {
+				std::remove(path.c_str());
+			}
+
+			std::cout << "Parallel prototype loading tests passed!" << std::endl;
+
+			// Test frame arena
+
+			EntitySystem frameSystem;
+			EntitySystem::FrameVector<EntityIndex> collected = frameSystem.MakeFrameVector<EntityIndex>();
+			for (EntityIndex i = 0; i < 1000; ++i) {
+				collected.push_back(i);
+			}
+			assert(collected.get_allocator().Resource() == frameSystem.GetFrameResource());
+			assert(frameSystem.GetFrameArena().BytesAllocated() >= 1000 * sizeof(EntityIndex));
+
+			MemoryResource* workerResource = nullptr;
+			std::thread frameWorker([&frameSystem, &workerResource]() {
+				workerResource = frameSystem.GetFrameResource();
+				EntitySystem::FrameVector<float> scratch(frameSystem.GetFrameAllocator<float>());
+				scratch.resize(100, 1.0f);
+			});
+			frameWorker.join();
+			assert(workerResource != frameSystem.GetFrameResource());
+			assert(frameSystem.GetFrameArena().ThreadCount() == 2);
+
+			// Spill past one block, then check later frames fit in a single one
+			for (int frame = 0; frame < 3; ++frame) {
+				EntitySystem::FrameVector<char> big(200000, 'x', frameSystem.GetFrameAllocator<char>());
+				frameSystem.Refresh();
+				assert(frameSystem.GetFrameArena().BytesAllocated() == 0);
+			}
+			std::size_t steadyBytes = frameSystem.MemoryStats().frameArenaBytes;
+			for (int frame = 0; frame < 3; ++frame) {
+				EntitySystem::FrameVector<char> big(200000, 'x', frameSystem.GetFrameAllocator<char>());
+				frameSystem.Refresh();
+			}
+			assert(frameSystem.MemoryStats().frameArenaBytes == steadyBytes);
+
+			// A world placed in an arena is dropped by releasing the arena,
+			// without its destructor; per-thread frame arenas and reservation
+			// overflow live there too
+			ArenaResource worldArena(64 * 1024);
+			{
+				void* worldStorage = worldArena.Allocate(sizeof(TEntitySystem<MyArenaSettings>), alignof(TEntitySystem<MyArenaSettings>));
+				TEntitySystem<MyArenaSettings>* world = new(worldStorage) TEntitySystem<MyArenaSettings>(&worldArena);
+				for (int i = 0; i < 100; ++i) {
+					world->AddComponent(world->CreateEntity(), PositionComponent());
+				}
+				world->Refresh();
+
+				std::size_t beforeThreads = worldArena.BytesAllocated();
+				std::size_t threadArenas = world->GetFrameArena().ThreadCount();
+				// Both threads run at once, so their ids differ
+				std::atomic<int> arrived{ 0 };
+				auto frameWork = [world, &arrived]() {
+					TEntitySystem<MyArenaSettings>::FrameVector<float> scratch(world->GetFrameAllocator<float>());
+					scratch.resize(1000, 1.0f);
+					for (int i = 0; i < 100; ++i) {
+						world->ReserveEntity();
+					}
+					++arrived;
+					while (arrived < 2) std::this_thread::yield();
+				};
+				std::thread first(frameWork), second(frameWork);
+				first.join();
+				second.join();
+				assert(world->GetFrameArena().ThreadCount() == threadArenas + 2);
+				assert(worldArena.BytesAllocated() >= beforeThreads + 2 * (sizeof(ArenaResource) + 1000 * sizeof(float)));
+			}
+			worldArena.Release();
+			assert(worldArena.BytesAllocated() == 0 && worldArena.BytesReserved() == 0);
+
+			std::cout << "Frame arena tests passed!" << std::endl;
+
+			// Test defragmentation
+
+			EntitySystem defragSystem;
+			std::vector<Entity> defragEntities;
+			for (int i = 0; i < 300; ++i) {
+				Entity e = defragSystem.CreateEntity();
+				defragEntities.push_back(e);
+			}
+			// Add in reverse so storage order is the opposite of entity order
+			for (int i = 299; i >= 0; --i) {
+				PositionComponent position;
+				position.x = float(i);
+				defragSystem.AddComponent(defragEntities[i], position);
+			}
+			for (int i = 0; i < 300; i += 3) {
+				defragSystem.RemoveComponent<PositionComponent>(defragEntities[i]);
+			}
+			for (int i = 0; i < 300; i += 7) {
+				defragSystem.Kill(defragEntities[i]);
+			}
+			defragSystem.Refresh();
+
+			auto storageMatchesEntities = [&defragSystem]() {
+				std::vector<Entity> stored, iterated;
+				defragSystem.ForEachComponent<PositionComponent>([&stored](Entity e, PositionComponent&) { stored.push_back(e); });
+				defragSystem.ForEntities([&defragSystem, &iterated](EntityIndex index) {
+					if (defragSystem.HasComponent<PositionComponent>(index)) {
+						iterated.push_back(defragSystem.GetEntity(index));
+					}
+				});
+				return stored == iterated;
+			};
+			assert(!storageMatchesEntities());
+
+			int defragSteps = 1;
+			while (!defragSystem.Defragment<PositionComponent>(16)) {
+				++defragSteps;
+			}
+			assert(defragSteps > 1);
+			assert(storageMatchesEntities());
+			std::vector<const char*> defragSlots;
+			defragSystem.ForEachComponent<PositionComponent>([&defragSlots](Entity, PositionComponent& position) {
+				defragSlots.push_back(reinterpret_cast<const char*>(&position));
+			});
+			for (std::size_t i = 1; i < defragSlots.size(); ++i) {
+				assert(defragSlots[i] - defragSlots[i - 1] == defragSlots[1] - defragSlots[0]);
+			}
+			defragSystem.ForEachComponent<PositionComponent>([](Entity e, PositionComponent& position) {
+				assert(e.id == std::size_t(position.x) + 1);
+			});
+
+			// Storage stays usable after relocation into free slots
+			Entity lateEntity = defragSystem.CreateEntity();
+			defragSystem.AddComponent(lateEntity, PositionComponent());
+			defragSystem.AddComponent(defragEntities[1], HealthComponent());
+			defragSystem.Refresh();
+			assert(defragSystem.DefragmentAll());
+			assert(storageMatchesEntities());
+
+			std::cout << "Defragmentation tests passed!" << std::endl;
+
+			// Test in-place and move-aware component adds
+
+			TEntitySystem<MyInventorySettings> inventorySystem;
+			Entity owner = inventorySystem.CreateEntity();
+			InventoryComponent::Copies() = 0;
+
+			InventoryComponent& emplaced = inventorySystem.EmplaceComponent<InventoryComponent>(owner, std::size_t(8));
+			assert(emplaced.items.size() == 8 && InventoryComponent::Copies() == 0);
+			assert(&inventorySystem.GetOrAdd<InventoryComponent>(owner) == &emplaced);
+
+			inventorySystem.AddComponent(owner, InventoryComponent(3));
+			assert(InventoryComponent::Copies() == 0 && emplaced.items.size() == 3);
+
+			InventoryComponent shared(5);
+			inventorySystem.AddComponent(owner, shared);
+			assert(InventoryComponent::Copies() == 1 && emplaced.items.size() == 5);
+
+			// Repeated adds reuse the slot instead of leaking a second one
+			assert(inventorySystem.MemoryStats().components[0].live == 1);
+			int inventoryVisits = 0;
+			inventorySystem.ForEachComponent<InventoryComponent>([&inventoryVisits](Entity, InventoryComponent&) { ++inventoryVisits; });
+			assert(inventoryVisits == 1);
+
+			Entity newcomer = inventorySystem.CreateEntity();
+			assert(inventorySystem.GetOrAdd<InventoryComponent>(newcomer, std::size_t(2)).items.size() == 2);
+			assert(inventorySystem.HasComponent<InventoryComponent>(newcomer));
+
+			TEntityPrototype<MyInventorySettings> inventoryPrototype("chest");
+			inventoryPrototype.Add(InventoryComponent(4));
+			assert(InventoryComponent::Copies() == 1);
+			assert(&inventoryPrototype.Get<InventoryComponent>() == inventoryPrototype.Find<InventoryComponent>());
+			assert(inventoryPrototype.Find<PositionComponent>() == nullptr);
+
+			Entity chest = inventoryPrototype.CreateEntity(inventorySystem);
+			assert(InventoryComponent::Copies() == 2);
+			assert(inventorySystem.GetComponent<InventoryComponent>(chest).items.size() == 4);
+
+			std::cout << "Component emplace tests passed!" << std::endl;
+
+			// Test dense component storage
+
+			TEntitySystem<MyDenseSettings> denseSystem;
+			std::vector<Entity> denseEntities;
+			for (int i = 0; i < 2500; ++i) {
+				Entity e = denseSystem.CreateEntity();
+				HealthComponent health;
+				health.health = float(i);
+				denseSystem.AddComponent(e, health);
+				denseEntities.push_back(e);
+			}
+			for (int i = 0; i < 2500; i += 3) {
+				denseSystem.RemoveComponent<HealthComponent>(denseEntities[i]);
+			}
+			for (int i = 1; i < 2500; i += 5) {
+				denseSystem.Kill(denseEntities[i]);
+			}
+			denseSystem.Refresh();
+
+			std::size_t denseCount = 0, denseSpans = 0;
+			denseSystem.ForComponentSpans<HealthComponent>([&](TSpan<const Entity> owners, TSpan<HealthComponent> components) {
+				++denseSpans;
+				for (std::size_t i = 0; i < components.size(); ++i) {
+					assert(owners[i] != Entity());
+					assert(&denseSystem.GetComponent<HealthComponent>(owners[i]) == &components[i]);
+					assert(components[i].health == float(owners[i].id - 1));
+				}
+				denseCount += components.size();
+			});
+
+			std::size_t expectedDense = 0;
+			denseSystem.ForEntities([&](EntityIndex index) {
+				expectedDense += denseSystem.HasComponent<HealthComponent>(index);
+			});
+			assert(denseCount == expectedDense && denseSpans == 2);
+			assert(denseSystem.MemoryStats().components[1].live == denseCount);
+
+			std::cout << "Dense storage tests passed!" << std::endl;
+
+			// Test shared components
+
+			TEntitySystem<MySharedSettings> sharedSystem;
+			TEntityPrototype<MySharedSettings> cowPrototype("cow");
+			cowPrototype.SetShared(MeshInfo{ 7, 1.0f });
+			cowPrototype.Add(PositionComponent());
+
+			std::vector<Entity> cows;
+			for (int i = 0; i < 100; ++i) {
+				cows.push_back(cowPrototype.CreateEntity(sharedSystem));
+			}
+			Entity bigCow = cows[10];
+			sharedSystem.SetShared(bigCow, MeshInfo{ 7, 2.0f });
+			Entity plain = sharedSystem.CreateEntity();
+
+			auto& meshStore = sharedSystem.GetSharedStore<MeshInfo>();
+			assert(meshStore.Count() == 2);
+			assert(&sharedSystem.GetShared<MeshInfo>(cows[0]) == &sharedSystem.GetShared<MeshInfo>(cows[99]));
+			assert(sharedSystem.GetShared<MeshInfo>(bigCow).scale == 2.0f);
+			assert(!sharedSystem.HasShared<MeshInfo>(plain));
+
+			sharedSystem.Kill(cows[0]);
+			sharedSystem.Refresh();
+
+			std::size_t meshGroups = 0, groupedCows = 0;
+			sharedSystem.ForSharedGroups<MeshInfo>([&](const MeshInfo& mesh, TSpan<const EntityIndex> indices) {
+				++meshGroups;
+				groupedCows += indices.size();
+				for (EntityIndex index : indices) {
+					assert(sharedSystem.GetShared<MeshInfo>(sharedSystem.GetEntity(index)) == mesh);
+				}
+				assert(std::is_sorted(indices.begin(), indices.end()));
+			});
+			assert(meshGroups == 2 && groupedCows == 99);
+
+			// Killed entities are skipped before Refresh(), and nested calls
+			// leave the outer spans intact
+			sharedSystem.Kill(cows[1]);
+			groupedCows = 0;
+			sharedSystem.ForSharedGroups<MeshInfo>([&](const MeshInfo&, TSpan<const EntityIndex> indices) {
+				std::vector<EntityIndex> outer(indices.begin(), indices.end());
+				sharedSystem.Kill(cows[2]);
+				sharedSystem.ForSharedGroups<MeshInfo>([&](const MeshInfo&, TSpan<const EntityIndex> inner) {
+					groupedCows += inner.size();
+				});
+				assert(std::equal(outer.begin(), outer.end(), indices.begin(), indices.end()));
+			});
+			assert(groupedCows == 2 * 97);
+
+			// The last reference frees the value
+			assert(sharedSystem.RemoveShared<MeshInfo>(bigCow));
+			assert(meshStore.Count() == 1);
+			sharedSystem.SetShared(plain, MeshInfo{ 9, 1.0f });
+			assert(meshStore.Count() == 2 && meshStore.HandleLimit() == 3);
+
+			sharedSystem.Clear();
+			assert(meshStore.Count() == 0);
+
+			std::cout << "Shared component tests passed!" << std::endl;
+
+			// Test owning groups
+
+			TEntitySystem<MyGroupSettings> groupSystem;
+			std::vector<Entity> grouped;
+			for (int i = 0; i < 3000; ++i) {
+				Entity e = groupSystem.CreateEntity();
+				if (i % 3 != 0) {
+					PositionComponent position;
+					position.x = float(i);
+					groupSystem.AddComponent(e, position);
+				}
+				if ((i / 2) % 2 == 0) {
+					HealthComponent health;
+					health.health = float(i);
+					groupSystem.AddComponent(e, health);
+				}
+				grouped.push_back(e);
+			}
+			for (int i = 0; i < 3000; i += 4) {
+				groupSystem.RemoveComponent<HealthComponent>(grouped[i]);
+			}
+			for (int i = 1; i < 3000; i += 9) {
+				groupSystem.Kill(grouped[i]);
+			}
+			groupSystem.Refresh();
+			groupSystem.SortComponents<PositionComponent>([](const PositionComponent& a, const PositionComponent& b) { return a.x > b.x; });
+			assert(groupSystem.Defragment<HealthComponent>());
+
+			auto checkGroup = [&groupSystem]() {
+				std::size_t members = 0;
+				groupSystem.ForGroup<S1>([&](Entity e, PositionComponent& position, HealthComponent& health) {
+					assert(&groupSystem.GetComponent<PositionComponent>(e) == &position);
+					assert(&groupSystem.GetComponent<HealthComponent>(e) == &health);
+					assert(position.x == health.health);
+					++members;
+				});
+				std::size_t matching = 0;
+				groupSystem.ForEntitiesMatching<S1>([&matching](EntityIndex, PositionComponent&, HealthComponent&) { ++matching; });
+				return members == matching && members == groupSystem.GroupSize<S1>();
+			};
+			assert(groupSystem.GroupSize<S1>() > 300);
+			assert(checkGroup());
+
+			// Entities killed but not yet refreshed are cleared too
+			for (int i = 2; i < 3000; i += 5) {
+				if (groupSystem.IsHandleValid(grouped[i])) groupSystem.Kill(grouped[i]);
+			}
+			groupSystem.Clear();
+			assert(groupSystem.GroupSize<S1>() == 0);
+			std::size_t ghosts = 0;
+			groupSystem.ForEachComponent<PositionComponent>([&ghosts](Entity, PositionComponent&) { ++ghosts; });
+			groupSystem.ForEachComponent<HealthComponent>([&ghosts](Entity, HealthComponent&) { ++ghosts; });
+			assert(ghosts == 0);
+			Entity regrouped = groupSystem.CreateEntity();
+			groupSystem.AddComponent(regrouped, HealthComponent());
+			groupSystem.AddComponent(regrouped, PositionComponent());
+			groupSystem.Refresh();
+			assert(groupSystem.GroupSize<S1>() == 1 && checkGroup());
+
+			std::cout << "Owning group tests passed!" << std::endl;
+
+			std::cout << "Runtime tests passed!" << std::endl;
+		}
+
+	}
 }
\ No newline at end of file
@@ -1,45 +1,84 @@
-#pragma once
-
-namespace ecs {
-	class Entity {
-	public:
-		std::size_t id;
-
-		Entity() : id{ 0 } {}
-
-		explicit Entity(std::size_t id) : id{ id } {}
-
-		bool operator==(const Entity& other) const {
-			return id == other.id;
-		}
-
-		bool operator!=(const Entity& other) const {
-			return id != other.id;
-		}
-
-		bool operator<(const Entity& other) const {
-			return id < other.id;
-		}
-
-		bool operator<=(const Entity& other) const {
-			return id <= other.id;
-		}
-
-		bool operator>(const Entity& other) const {
-			return id > other.id;
-		}
-
-		bool operator>=(const Entity& other) const {
-			return id >= other.id;
-		}
-	};
-}
-
-namespace std {
-	template <>
-	struct hash<ecs::Entity> {
-		size_t operator()(const ecs::Entity& k) const {
-			return hash<size_t>()(k.id);
-		}
-	};
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ecs {
+	// Entity handle. The id packs a handle slot in the low IndexBits and a
+	// generation in the high GenerationBits; with no generation bits the id
+	// is a plain counter that is never reused. Id 0 is the null handle.
+
+	template <typename TId, unsigned TGenerationBits>
+	class TEntity {
+	public:
+		using Id = TId;
+
+		static constexpr unsigned GenerationBits = TGenerationBits;
+		static constexpr unsigned IndexBits = unsigned(sizeof(TId) * 8) - GenerationBits;
+
+		static_assert(GenerationBits < sizeof(TId) * 8, "");
+
+		TId id;
+
+		TEntity() : id{ 0 } {}
+
+		explicit TEntity(TId id) : id{ id } {}
+
+		// Handle slot mask; with no generation bits every bit belongs to it
+		static constexpr std::uint64_t IndexMask = GenerationBits ? (std::uint64_t(1) << (IndexBits & 63)) - 1 : ~std::uint64_t(0);
+
+		static TEntity Make(std::size_t index, std::size_t generation) {
+			return TEntity(TId(std::uint64_t(index) | (GenerationBits ? std::uint64_t(generation) << (IndexBits & 63) : 0)));
+		}
+
+		std::size_t Index() const {
+			return std::size_t(std::uint64_t(id) & IndexMask);
+		}
+
+		std::size_t Generation() const {
+			return GenerationBits ? std::size_t(std::uint64_t(id) >> (IndexBits & 63)) : 0;
+		}
+
+		bool operator==(const TEntity& other) const {
+			return id == other.id;
+		}
+
+		bool operator!=(const TEntity& other) const {
+			return id != other.id;
+		}
+
+		bool operator<(const TEntity& other) const {
+			return id < other.id;
+		}
+
+		bool operator<=(const TEntity& other) const {
+			return id <= other.id;
+		}
+
+		bool operator>(const TEntity& other) const {
+			return id > other.id;
+		}
+
+		bool operator>=(const TEntity& other) const {
+			return id >= other.id;
+		}
+	};
+
+	// 64-bit handle from a per-world counter
+	using Entity = TEntity<std::size_t, 0>;
+
+	// 32-bit handle: 24-bit slot index and 8-bit generation. Slots are
+	// reused once their entity is destroyed; the generation tells the old
+	// and new occupant apart for 256 reuses.
+	using CompactEntity = TEntity<std::uint32_t, 8>;
+}
+
+namespace std {
+	template <typename TId, unsigned TGenerationBits>
+	struct hash<ecs::TEntity<TId, TGenerationBits>> {
+		size_t operator()(const ecs::TEntity<TId, TGenerationBits>& k) const {
+			return hash<TId>()(k.id);
+		}
+	};
 }
\ No newline at end of file
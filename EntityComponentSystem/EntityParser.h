@@ -1,49 +1,391 @@
-#pragma once
-
-#include "json/json.h"
-#include <iostream>
-#include <typeindex>
-#include "TEntityPrototype.h"
-#include "Component.h"
-
-namespace ecs {
-	namespace EntityParser {
-
-		template <typename TSettings>
-		static TEntityPrototype<TSettings> CreatePrototype(const std::string& name, Json::Value root) {
-			TEntityPrototype<TSettings> proto(name);
-
-			std::vector<std::string> components = root.getMemberNames();
-
-			using ComponentList = typename TSettings::ComponentList;
-			ComponentList::ForTypes([&proto, &root, &components](auto t) {
-				TYPE_OF(t) component;
-				std::string componentName = component.Name();
-				auto foundIter = std::find(components.begin(), components.end(), componentName);
-				if (foundIter != components.end()) {
-					component.Deserialize(root.get(componentName, ""));
-					proto.Add(component);
-				}
-			});
-
-			return proto;
-		}
-
-		template <typename TSettings>
-		static std::vector<TEntityPrototype<TSettings>> ParseTypes(Json::Value root) {
-
-			std::vector<TEntityPrototype<TSettings>> prototypes;
-
-			std::vector<std::string> entityNames = root.getMemberNames();
-			for (std::size_t i = 0; i < entityNames.size(); ++i) {
-				Json::Value typeRoot = root.get(entityNames[i], "");
-				if (typeRoot.isObject()) {
-					prototypes.push_back(CreatePrototype<TSettings>(entityNames[i], typeRoot));
-				}
-			}
-
-			return prototypes;
-		}
-
-	}
+#pragma once
+
+#include "json/json.h"
+#include <memory>
+#include <iostream>
+#include <typeindex>
+#include <type_traits>
+#include <unordered_map>
+#include "TEntityPrototype.h"
+#include "Component.h"
+#include "FastJson.h"
+#include "ThreadPool.h"
+
+namespace ecs {
+	struct PrototypeParseReport {
+		std::size_t prototypes{ 0 };
+		bool fromCache{ false };
+		std::vector<std::string> errors;
+		std::vector<std::string> warnings;
+
+		bool Ok() const noexcept {
+			return errors.empty();
+		}
+	};
+
+	namespace EntityParser {
+
+		// Components may add Deserialize(const FastJson::Value&) to read
+		// FastJson documents directly; others get a jsoncpp copy of their
+		// member.
+		template <typename T, typename = void>
+		struct HasFastDeserialize : std::false_type {};
+
+		template <typename T>
+		struct HasFastDeserialize<T, decltype(std::declval<T&>().Deserialize(std::declval<const FastJson::Value&>()), void())> : std::true_type {};
+
+		template <typename T>
+		void deserialize(T& component, const FastJson::Value& root, std::true_type) {
+			component.Deserialize(root);
+		}
+
+		template <typename T>
+		void deserialize(T& component, const FastJson::Value& root, std::false_type) {
+			component.Deserialize(FastJson::ToJsonValue(root));
+		}
+
+		// Access to prototype members for both document types, by pointer
+		// for jsoncpp and by view for FastJson; both test false when missing
+
+		inline const Json::Value* findMember(const Json::Value* root, const std::string& key) {
+			return root->isMember(key) ? &(*root)[key] : nullptr;
+		}
+
+		inline FastJson::Value findMember(FastJson::Value root, const std::string& key) {
+			return root[key];
+		}
+
+		inline bool isString(const Json::Value* value) { return value->isString(); }
+		inline bool isString(FastJson::Value value) { return value.IsString(); }
+
+		inline std::string asString(const Json::Value* value) { return value->asString(); }
+		inline std::string asString(FastJson::Value value) { return value.AsString(); }
+
+		template <typename T>
+		void deserializeMember(T& component, const Json::Value* member) {
+			component.Deserialize(*member);
+		}
+
+		template <typename T>
+		void deserializeMember(T& component, FastJson::Value member) {
+			deserialize(component, member, HasFastDeserialize<T>());
+		}
+
+		// Overlays the fields of `member` on `merged`; a member that is not
+		// an object replaces it whole
+		inline void mergeMember(Json::Value& merged, const Json::Value* member) {
+			if (!member->isObject() || !merged.isObject()) {
+				merged = *member;
+				return;
+			}
+			for (const std::string& field : member->getMemberNames()) {
+				merged[field] = (*member)[field];
+			}
+		}
+
+		inline void mergeMember(Json::Value& merged, FastJson::Value member) {
+			if (!member.IsObject() || !merged.isObject()) {
+				merged = FastJson::ToJsonValue(member);
+				return;
+			}
+			for (FastJson::Value field : member) {
+				merged[field.Key()] = FastJson::ToJsonValue(field);
+			}
+		}
+
+		// One prototype object awaiting inheritance resolution. `origin`
+		// names the file it came from, if any, for error messages.
+		template <typename TRef>
+		struct PrototypeSource {
+			std::string name;
+			TRef value;
+			std::string base;
+			std::string origin;
+		};
+
+		inline std::string sourceLabel(const std::string& origin, const std::string& name) {
+			return origin.empty() ? name : origin + ": " + name;
+		}
+
+		template <typename TRef>
+		void addSource(std::vector<PrototypeSource<TRef>>& sources, const std::string& name, TRef value, PrototypeParseReport& report,
+			const std::string& origin = std::string()) {
+
+			std::string base;
+			if (TRef extends = findMember(value, "extends")) {
+				if (!isString(extends)) {
+					report.errors.push_back(sourceLabel(origin, name) + ": \"extends\" must name a prototype");
+					return;
+				}
+				base = asString(extends);
+			}
+			sources.push_back(PrototypeSource<TRef>{ name, value, std::move(base), origin });
+		}
+
+		inline void printErrors(const PrototypeParseReport& report) {
+			for (const std::string& error : report.errors) {
+				std::cerr << "EntityParser: " << error << std::endl;
+			}
+		}
+
+		// Flattens one prototype on top of its resolved base
+		template <typename TSettings, typename TRef>
+		TEntityPrototype<TSettings> flattenPrototype(const std::vector<PrototypeSource<TRef>>& sources, const std::vector<std::size_t>& parents,
+			std::size_t index, const TEntityPrototype<TSettings>* base, MemoryResource* resource) {
+
+			const PrototypeSource<TRef>& source = sources[index];
+			TEntityPrototype<TSettings> proto(source.name, resource);
+			if (base) {
+				proto.Inherit(*base);
+			}
+
+			using ComponentList = typename TSettings::ComponentList;
+			ComponentList::ForTypes([&](auto t) {
+				using ComponentType = TYPE_OF(t);
+				ComponentType component;
+				const std::string componentName = component.Name();
+				TRef member = findMember(source.value, componentName);
+				if (!member) return;
+
+				if (!base || !base->template Contains<ComponentType>()) {
+					deserializeMember(component, member);
+				}
+				else {
+					// Merge the definitions along the chain, root first
+					std::vector<TRef> chain;
+					for (std::size_t i = index; i != std::size_t(-1); i = parents[i]) {
+						if (TRef definition = findMember(sources[i].value, componentName)) {
+							chain.push_back(definition);
+						}
+					}
+					Json::Value merged(Json::objectValue);
+					for (auto definition = chain.rbegin(); definition != chain.rend(); ++definition) {
+						mergeMember(merged, *definition);
+					}
+					component.Deserialize(merged);
+				}
+				proto.Add(std::move(component));
+			});
+
+			return proto;
+		}
+
+		template <typename TSettings, typename TRef>
+		std::vector<TEntityPrototype<TSettings>> resolvePrototypes(const std::vector<PrototypeSource<TRef>>& sources, PrototypeParseReport& report,
+			ThreadPool* pool, MemoryResource* resource) {
+
+			using Prototype = TEntityPrototype<TSettings>;
+			static constexpr std::size_t None = std::size_t(-1);
+			enum State : char { Unvisited, Visiting, Valid, Invalid };
+
+			const std::size_t count = sources.size();
+			std::vector<std::size_t> parents(count, None);
+			std::vector<char> states(count, Unvisited);
+
+			// Link every prototype to its base
+			std::unordered_map<std::string, std::size_t> indices;
+			for (std::size_t i = 0; i < count; ++i) {
+				auto inserted = indices.emplace(sources[i].name, i);
+				if (!inserted.second) {
+					const std::string& firstOrigin = sources[inserted.first->second].origin;
+					report.errors.push_back(sourceLabel(sources[i].origin, sources[i].name) + ": duplicate prototype" +
+						(firstOrigin.empty() ? std::string() : ", first defined in " + firstOrigin));
+					states[i] = Invalid;
+				}
+			}
+			for (std::size_t i = 0; i < count; ++i) {
+				if (states[i] == Invalid || sources[i].base.empty()) continue;
+				auto base = indices.find(sources[i].base);
+				if (base == indices.end()) {
+					report.errors.push_back(sourceLabel(sources[i].origin, sources[i].name) + ": extends unknown prototype \"" + sources[i].base + "\"");
+					states[i] = Invalid;
+				}
+				else {
+					parents[i] = base->second;
+				}
+			}
+
+			// Walk each chain up to a root or an already classified prototype;
+			// arriving back on the current walk means a cycle
+			std::vector<std::size_t> path;
+			for (std::size_t i = 0; i < count; ++i) {
+				path.clear();
+				std::size_t j = i;
+				while (j != None && states[j] == Unvisited) {
+					states[j] = Visiting;
+					path.push_back(j);
+					j = parents[j];
+				}
+				if (path.empty()) continue;
+
+				std::size_t cycleStart = path.size();
+				if (j != None && states[j] == Visiting) {
+					cycleStart = std::size_t(std::find(path.begin(), path.end(), j) - path.begin());
+					std::string cycle;
+					for (std::size_t k = cycleStart; k < path.size(); ++k) {
+						cycle += sources[path[k]].name + " -> ";
+					}
+					report.errors.push_back("inheritance cycle: " + cycle + sources[j].name);
+				}
+
+				const bool valid = j == None || states[j] == Valid;
+				for (std::size_t k = 0; k < path.size(); ++k) {
+					states[path[k]] = valid ? Valid : Invalid;
+					if (!valid && k < cycleStart) {
+						report.errors.push_back(sourceLabel(sources[path[k]].origin, sources[path[k]].name) + ": base \"" + sources[path[k]].base + "\" could not be resolved");
+					}
+				}
+			}
+
+			// Independent trees, each listed parents before children
+			std::vector<std::vector<std::size_t>> children(count);
+			std::vector<std::vector<std::size_t>> trees;
+			for (std::size_t i = 0; i < count; ++i) {
+				if (states[i] != Valid) continue;
+				if (parents[i] == None) {
+					trees.push_back(std::vector<std::size_t>{ i });
+				}
+				else {
+					children[parents[i]].push_back(i);
+				}
+			}
+			for (std::vector<std::size_t>& tree : trees) {
+				for (std::size_t k = 0; k < tree.size(); ++k) {
+					const std::vector<std::size_t>& derived = children[tree[k]];
+					tree.insert(tree.end(), derived.begin(), derived.end());
+				}
+			}
+
+			std::vector<std::unique_ptr<Prototype>> resolved(count);
+			auto resolveTree = [&](std::size_t t) {
+				for (std::size_t i : trees[t]) {
+					const Prototype* base = parents[i] != None ? resolved[parents[i]].get() : nullptr;
+					resolved[i].reset(new Prototype(flattenPrototype<TSettings>(sources, parents, i, base, resource)));
+				}
+			};
+			if (pool && !resource) {
+				pool->ParallelFor(trees.size(), resolveTree);
+			}
+			else {
+				for (std::size_t t = 0; t < trees.size(); ++t) {
+					resolveTree(t);
+				}
+			}
+
+			// Source order, whatever order the trees finished in
+			std::vector<Prototype> prototypes;
+			prototypes.reserve(count);
+			for (std::unique_ptr<Prototype>& proto : resolved) {
+				if (proto) {
+					prototypes.push_back(std::move(*proto));
+				}
+			}
+			report.prototypes += prototypes.size();
+			return prototypes;
+		}
+
+		template <typename TSettings>
+		static TEntityPrototype<TSettings> CreatePrototype(const std::string& name, const Json::Value& root, MemoryResource* resource = nullptr) {
+			TEntityPrototype<TSettings> proto(name, resource);
+
+			std::vector<std::string> components = root.getMemberNames();
+
+			using ComponentList = typename TSettings::ComponentList;
+			ComponentList::ForTypes([&proto, &root, &components](auto t) {
+				TYPE_OF(t) component;
+				std::string componentName = component.Name();
+				auto foundIter = std::find(components.begin(), components.end(), componentName);
+				if (foundIter != components.end()) {
+					component.Deserialize(root.get(componentName, ""));
+					proto.Add(component);
+				}
+			});
+
+			return proto;
+		}
+
+		// Prototype objects may name a base with "extends": "baseName". A
+		// derived prototype starts with every component of its base, and a
+		// component given at several levels has its fields merged, derived
+		// fields winning, before it is deserialized once. Inheritance is
+		// resolved here, so the returned prototypes are flat and creating
+		// entities from them costs no lookups.
+		//
+		// Prototypes with an unknown base, on an inheritance cycle, or
+		// derived from either are left out and reported. Independent
+		// inheritance trees are resolved concurrently when a pool is given
+		// and no resource is, since resources need not be thread safe.
+		template <typename TSettings>
+		static std::vector<TEntityPrototype<TSettings>> ParseTypes(const Json::Value& root, PrototypeParseReport& report,
+			ThreadPool* pool = nullptr, MemoryResource* resource = nullptr) {
+
+			std::vector<PrototypeSource<const Json::Value*>> sources;
+
+			std::vector<std::string> entityNames = root.getMemberNames();
+			for (std::size_t i = 0; i < entityNames.size(); ++i) {
+				const Json::Value& typeRoot = root[entityNames[i]];
+				if (typeRoot.isObject()) {
+					addSource(sources, entityNames[i], &typeRoot, report);
+				}
+			}
+
+			return resolvePrototypes<TSettings>(sources, report, pool, resource);
+		}
+
+		template <typename TSettings>
+		static std::vector<TEntityPrototype<TSettings>> ParseTypes(const Json::Value& root, MemoryResource* resource = nullptr) {
+			PrototypeParseReport report;
+			std::vector<TEntityPrototype<TSettings>> prototypes = ParseTypes<TSettings>(root, report, nullptr, resource);
+			printErrors(report);
+			return prototypes;
+		}
+
+		// Same entry points over a FastJson document. Unlike jsoncpp, which
+		// sorts members by name, prototypes come back in document order.
+
+		template <typename TSettings>
+		static TEntityPrototype<TSettings> CreatePrototype(const std::string& name, const FastJson::Value& root, MemoryResource* resource = nullptr) {
+			TEntityPrototype<TSettings> proto(name, resource);
+
+			using ComponentList = typename TSettings::ComponentList;
+			ComponentList::ForTypes([&proto, &root](auto t) {
+				using ComponentType = TYPE_OF(t);
+				ComponentType component;
+				FastJson::Value member = root[component.Name()];
+				if (member) {
+					deserialize(component, member, HasFastDeserialize<ComponentType>());
+					proto.Add(component);
+				}
+			});
+
+			return proto;
+		}
+
+		// A repeated prototype name is reported and only its first
+		// definition kept
+		template <typename TSettings>
+		static std::vector<TEntityPrototype<TSettings>> ParseTypes(const FastJson::Value& root, PrototypeParseReport& report,
+			ThreadPool* pool = nullptr, MemoryResource* resource = nullptr) {
+
+			std::vector<PrototypeSource<FastJson::Value>> sources;
+			sources.reserve(root.Size());
+
+			for (FastJson::Value typeRoot : root) {
+				if (typeRoot.IsObject()) {
+					addSource(sources, typeRoot.Key(), typeRoot, report);
+				}
+			}
+
+			return resolvePrototypes<TSettings>(sources, report, pool, resource);
+		}
+
+		template <typename TSettings>
+		static std::vector<TEntityPrototype<TSettings>> ParseTypes(const FastJson::Value& root, MemoryResource* resource = nullptr) {
+			PrototypeParseReport report;
+			std::vector<TEntityPrototype<TSettings>> prototypes = ParseTypes<TSettings>(root, report, nullptr, resource);
+			printErrors(report);
+			return prototypes;
+		}
+
+	}
 }
\ No newline at end of file
@@ -0,0 +1,554 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "json/json.h"
+#include "MemoryResource.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ECS_FASTJSON_SSE2 1
+#endif
+
+namespace ecs {
+	namespace FastJson {
+		// High-throughput JSON reader for prototype files. Strings are decoded
+		// in place inside the parsed buffer and every value is a node of one
+		// flat array, so a parse costs a single growing allocation instead of
+		// one per value. String contents and whitespace runs are scanned 16
+		// bytes at a time with SSE2 where available.
+		//
+		// The reader is lenient where jsoncpp is: control characters inside
+		// strings are accepted and duplicate keys are kept.
+
+		enum class Type : std::uint8_t {
+			Null, Bool, Number, String, Array, Object
+		};
+
+		// Children of an array or object follow their parent directly;
+		// `next` is the index just past a node's subtree.
+		struct Node {
+			Type type;
+			bool boolean;
+			bool integral;
+			std::uint32_t keyLength;
+			std::uint32_t length;
+			std::uint32_t next;
+			const char* key;
+			const char* string;
+			double number;
+		};
+
+		// Lightweight view of a node. A default constructed Value stands for
+		// a missing member and reads as null.
+		class Value {
+		public:
+			Value() noexcept : m_nodes{ nullptr }, m_index{ 0 } {}
+
+			Value(const Node* nodes, std::uint32_t index) noexcept : m_nodes{ nodes }, m_index{ index } {}
+
+			explicit operator bool() const noexcept { return m_nodes != nullptr; }
+
+			Type GetType() const noexcept { return m_nodes ? node().type : Type::Null; }
+
+			bool IsNull() const noexcept { return GetType() == Type::Null; }
+			bool IsBool() const noexcept { return GetType() == Type::Bool; }
+			bool IsNumber() const noexcept { return GetType() == Type::Number; }
+			bool IsString() const noexcept { return GetType() == Type::String; }
+			bool IsArray() const noexcept { return GetType() == Type::Array; }
+			bool IsObject() const noexcept { return GetType() == Type::Object; }
+
+			bool IsIntegral() const noexcept { return IsNumber() && node().integral; }
+
+			double AsDouble(double fallback = 0) const noexcept { return IsNumber() ? node().number : fallback; }
+			float AsFloat(float fallback = 0) const noexcept { return IsNumber() ? float(node().number) : fallback; }
+			int AsInt(int fallback = 0) const noexcept { return IsNumber() ? int(node().number) : fallback; }
+			bool AsBool(bool fallback = false) const noexcept { return IsBool() ? node().boolean : fallback; }
+
+			std::string AsString() const {
+				return IsString() ? std::string(node().string, node().length) : std::string();
+			}
+
+			const char* StringData() const noexcept { return IsString() ? node().string : ""; }
+			std::size_t StringLength() const noexcept { return IsString() ? node().length : 0; }
+
+			// Member key when this value belongs to an object
+			std::string Key() const { return m_nodes && node().key ? std::string(node().key, node().keyLength) : std::string(); }
+			const char* KeyData() const noexcept { return m_nodes ? node().key : nullptr; }
+			std::size_t KeyLength() const noexcept { return m_nodes ? node().keyLength : 0; }
+
+			// Number of elements or members
+			std::size_t Size() const noexcept { return IsArray() || IsObject() ? node().length : 0; }
+
+			// Linear member lookup; prototype objects are small
+			Value Find(const char* key, std::size_t keyLength) const noexcept {
+				if (!IsObject()) return Value();
+				for (Value member : *this) {
+					if (member.KeyLength() == keyLength && std::memcmp(member.KeyData(), key, keyLength) == 0) {
+						return member;
+					}
+				}
+				return Value();
+			}
+
+			Value operator[](const char* key) const noexcept { return Find(key, std::strlen(key)); }
+			Value operator[](const std::string& key) const noexcept { return Find(key.data(), key.size()); }
+
+			// Also taking int keeps v[0] from being read as a null key
+			Value operator[](int i) const noexcept { return i < 0 ? Value() : (*this)[std::size_t(i)]; }
+
+			Value operator[](std::size_t i) const noexcept {
+				if (!IsArray() || i >= node().length) return Value();
+				std::uint32_t child = m_index + 1;
+				while (i--) child = m_nodes[child].next;
+				return Value(m_nodes, child);
+			}
+
+			class Iterator {
+			public:
+				Iterator(const Node* nodes, std::uint32_t index) noexcept : m_nodes{ nodes }, m_index{ index } {}
+
+				Value operator*() const noexcept { return Value(m_nodes, m_index); }
+				Iterator& operator++() noexcept { m_index = m_nodes[m_index].next; return *this; }
+				bool operator!=(const Iterator& other) const noexcept { return m_index != other.m_index; }
+
+			private:
+				const Node* m_nodes;
+				std::uint32_t m_index;
+			};
+
+			// Iterates the elements of an array or the members of an object
+			Iterator begin() const noexcept {
+				return IsArray() || IsObject() ? Iterator(m_nodes, m_index + 1) : Iterator(m_nodes, 0);
+			}
+
+			Iterator end() const noexcept {
+				return IsArray() || IsObject() ? Iterator(m_nodes, node().next) : Iterator(m_nodes, 0);
+			}
+
+		private:
+			const Node* m_nodes;
+			std::uint32_t m_index;
+
+			const Node& node() const noexcept { return m_nodes[m_index]; }
+		};
+
+		class Document {
+		public:
+			explicit Document(MemoryResource* resource = nullptr) :
+				m_nodes(TResourceAllocator<Node>(resource ? resource : GetDefaultResource())) {}
+
+			Document(const Document&) = delete;
+			Document& operator=(const Document&) = delete;
+
+			// Parses a copy of `text` kept by the document
+			bool Parse(const std::string& text) {
+				m_buffer = text;
+				return ParseInSitu(&m_buffer[0], m_buffer.size());
+			}
+
+			// Parses `text` in place. text[length] must be '\0' and the buffer
+			// must outlive the document, since strings point into it.
+			bool ParseInSitu(char* text, std::size_t length) {
+				m_nodes.clear();
+				m_nodes.reserve(length / 16 + 16);
+				m_error.clear();
+				m_begin = m_cursor = text;
+				m_end = text + length;
+
+				skipWhitespace();
+				if (!parseValue(nullptr, 0, 0)) return false;
+				skipWhitespace();
+				if (m_cursor != m_end) return fail("unexpected trailing characters");
+				return true;
+			}
+
+			Value Root() const noexcept {
+				return m_nodes.empty() ? Value() : Value(m_nodes.data(), 0);
+			}
+
+			const std::string& GetError() const noexcept { return m_error; }
+			std::size_t GetErrorOffset() const noexcept { return m_errorOffset; }
+
+			std::size_t NodeCount() const noexcept { return m_nodes.size(); }
+
+		private:
+			static const unsigned MaxDepth = 512;
+
+			std::vector<Node, TResourceAllocator<Node>> m_nodes;
+			std::string m_buffer;
+			std::string m_error;
+			std::size_t m_errorOffset{ 0 };
+
+			char* m_begin{ nullptr };
+			char* m_cursor{ nullptr };
+			char* m_end{ nullptr };
+
+			bool fail(const char* message) {
+				m_error = message;
+				m_errorOffset = std::size_t(m_cursor - m_begin);
+				return false;
+			}
+
+			static bool isWhitespace(char c) noexcept {
+				return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+			}
+
+			void skipWhitespace() noexcept {
+				if (m_cursor == m_end || !isWhitespace(*m_cursor)) return;
+#ifdef ECS_FASTJSON_SSE2
+				while (m_end - m_cursor >= 16) {
+					__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_cursor));
+					__m128i ws = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))));
+					unsigned mask = ~unsigned(_mm_movemask_epi8(ws)) & 0xFFFFu;
+					if (mask) {
+						m_cursor += countTrailingZeros(mask);
+						return;
+					}
+					m_cursor += 16;
+				}
+#endif
+				while (m_cursor != m_end && isWhitespace(*m_cursor)) ++m_cursor;
+			}
+
+			static unsigned countTrailingZeros(unsigned mask) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+				return unsigned(__builtin_ctz(mask));
+#else
+				unsigned count = 0;
+				for (; !(mask & 1); mask >>= 1) ++count;
+				return count;
+#endif
+			}
+
+			// Advances to the first '"' or '\\' at or after the cursor
+			void scanString() noexcept {
+#ifdef ECS_FASTJSON_SSE2
+				while (m_end - m_cursor >= 16) {
+					__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_cursor));
+					unsigned mask = unsigned(_mm_movemask_epi8(_mm_or_si128(
+						_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))));
+					if (mask) {
+						m_cursor += countTrailingZeros(mask);
+						return;
+					}
+					m_cursor += 16;
+				}
+#endif
+				while (m_cursor != m_end && *m_cursor != '"' && *m_cursor != '\\') ++m_cursor;
+			}
+
+			std::uint32_t pushNode(Type type, const char* key, std::uint32_t keyLength) {
+				Node node;
+				node.type = type;
+				node.boolean = false;
+				node.integral = false;
+				node.keyLength = keyLength;
+				node.length = 0;
+				node.next = 0;
+				node.key = key;
+				node.string = nullptr;
+				node.number = 0;
+				m_nodes.push_back(node);
+				return std::uint32_t(m_nodes.size() - 1);
+			}
+
+			bool parseValue(const char* key, std::uint32_t keyLength, unsigned depth) {
+				if (m_cursor == m_end) return fail("unexpected end of input");
+
+				switch (*m_cursor) {
+				case '{': return parseObject(key, keyLength, depth);
+				case '[': return parseArray(key, keyLength, depth);
+				case '"': {
+					std::uint32_t index = pushNode(Type::String, key, keyLength);
+					const char* string;
+					std::uint32_t length;
+					if (!parseString(string, length)) return false;
+					m_nodes[index].string = string;
+					m_nodes[index].length = length;
+					m_nodes[index].next = index + 1;
+					return true;
+				}
+				case 't': return parseLiteral("true", Type::Bool, true, key, keyLength);
+				case 'f': return parseLiteral("false", Type::Bool, false, key, keyLength);
+				case 'n': return parseLiteral("null", Type::Null, false, key, keyLength);
+				default: return parseNumber(key, keyLength);
+				}
+			}
+
+			bool parseObject(const char* key, std::uint32_t keyLength, unsigned depth) {
+				if (depth >= MaxDepth) return fail("nesting too deep");
+				std::uint32_t index = pushNode(Type::Object, key, keyLength);
+				std::uint32_t count = 0;
+
+				++m_cursor;
+				skipWhitespace();
+				if (m_cursor != m_end && *m_cursor == '}') {
+					++m_cursor;
+				}
+				else {
+					while (true) {
+						if (m_cursor == m_end || *m_cursor != '"') return fail("expected member name");
+						const char* memberKey;
+						std::uint32_t memberKeyLength;
+						if (!parseString(memberKey, memberKeyLength)) return false;
+
+						skipWhitespace();
+						if (m_cursor == m_end || *m_cursor != ':') return fail("expected ':'");
+						++m_cursor;
+						skipWhitespace();
+						if (!parseValue(memberKey, memberKeyLength, depth + 1)) return false;
+						++count;
+
+						skipWhitespace();
+						if (m_cursor != m_end && *m_cursor == ',') {
+							++m_cursor;
+							skipWhitespace();
+							continue;
+						}
+						if (m_cursor != m_end && *m_cursor == '}') {
+							++m_cursor;
+							break;
+						}
+						return fail("expected ',' or '}'");
+					}
+				}
+
+				m_nodes[index].length = count;
+				m_nodes[index].next = std::uint32_t(m_nodes.size());
+				return true;
+			}
+
+			bool parseArray(const char* key, std::uint32_t keyLength, unsigned depth) {
+				if (depth >= MaxDepth) return fail("nesting too deep");
+				std::uint32_t index = pushNode(Type::Array, key, keyLength);
+				std::uint32_t count = 0;
+
+				++m_cursor;
+				skipWhitespace();
+				if (m_cursor != m_end && *m_cursor == ']') {
+					++m_cursor;
+				}
+				else {
+					while (true) {
+						if (!parseValue(nullptr, 0, depth + 1)) return false;
+						++count;
+
+						skipWhitespace();
+						if (m_cursor != m_end && *m_cursor == ',') {
+							++m_cursor;
+							skipWhitespace();
+							continue;
+						}
+						if (m_cursor != m_end && *m_cursor == ']') {
+							++m_cursor;
+							break;
+						}
+						return fail("expected ',' or ']'");
+					}
+				}
+
+				m_nodes[index].length = count;
+				m_nodes[index].next = std::uint32_t(m_nodes.size());
+				return true;
+			}
+
+			bool parseLiteral(const char* literal, Type type, bool value, const char* key, std::uint32_t keyLength) {
+				std::size_t length = std::strlen(literal);
+				if (std::size_t(m_end - m_cursor) < length || std::memcmp(m_cursor, literal, length) != 0) {
+					return fail("invalid literal");
+				}
+				m_cursor += length;
+				std::uint32_t index = pushNode(type, key, keyLength);
+				m_nodes[index].boolean = value;
+				m_nodes[index].next = index + 1;
+				return true;
+			}
+
+			// Decodes the string at the cursor in place; escapes only ever
+			// shrink the text, so the decoded bytes overwrite the source
+			bool parseString(const char*& string, std::uint32_t& length) {
+				char* start = ++m_cursor;
+				scanString();
+				if (m_cursor != m_end && *m_cursor == '"') {
+					string = start;
+					length = std::uint32_t(m_cursor - start);
+					++m_cursor;
+					return true;
+				}
+
+				char* out = m_cursor;
+				while (true) {
+					if (m_cursor == m_end) return fail("unterminated string");
+					char c = *m_cursor;
+					if (c == '"') break;
+					if (c != '\\') {
+						*out++ = c;
+						++m_cursor;
+						continue;
+					}
+					if (m_end - m_cursor < 2) return fail("unterminated escape");
+					char escape = m_cursor[1];
+					m_cursor += 2;
+					switch (escape) {
+					case '"': *out++ = '"'; break;
+					case '\\': *out++ = '\\'; break;
+					case '/': *out++ = '/'; break;
+					case 'b': *out++ = '\b'; break;
+					case 'f': *out++ = '\f'; break;
+					case 'n': *out++ = '\n'; break;
+					case 'r': *out++ = '\r'; break;
+					case 't': *out++ = '\t'; break;
+					case 'u': {
+						unsigned codepoint;
+						if (!parseHex4(codepoint)) return fail("invalid \\u escape");
+						if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+							unsigned low;
+							if (m_end - m_cursor < 2 || m_cursor[0] != '\\' || m_cursor[1] != 'u') return fail("unpaired surrogate");
+							m_cursor += 2;
+							if (!parseHex4(low) || low < 0xDC00 || low > 0xDFFF) return fail("unpaired surrogate");
+							codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+						}
+						out = writeUtf8(out, codepoint);
+						break;
+					}
+					default: return fail("invalid escape");
+					}
+				}
+
+				string = start;
+				length = std::uint32_t(out - start);
+				++m_cursor;
+				return true;
+			}
+
+			bool parseHex4(unsigned& value) noexcept {
+				if (m_end - m_cursor < 4) return false;
+				value = 0;
+				for (int i = 0; i < 4; ++i) {
+					char c = *m_cursor++;
+					value <<= 4;
+					if (c >= '0' && c <= '9') value |= unsigned(c - '0');
+					else if (c >= 'a' && c <= 'f') value |= unsigned(c - 'a' + 10);
+					else if (c >= 'A' && c <= 'F') value |= unsigned(c - 'A' + 10);
+					else return false;
+				}
+				return true;
+			}
+
+			static char* writeUtf8(char* out, unsigned codepoint) noexcept {
+				if (codepoint < 0x80) {
+					*out++ = char(codepoint);
+				}
+				else if (codepoint < 0x800) {
+					*out++ = char(0xC0 | (codepoint >> 6));
+					*out++ = char(0x80 | (codepoint & 0x3F));
+				}
+				else if (codepoint < 0x10000) {
+					*out++ = char(0xE0 | (codepoint >> 12));
+					*out++ = char(0x80 | ((codepoint >> 6) & 0x3F));
+					*out++ = char(0x80 | (codepoint & 0x3F));
+				}
+				else {
+					*out++ = char(0xF0 | (codepoint >> 18));
+					*out++ = char(0x80 | ((codepoint >> 12) & 0x3F));
+					*out++ = char(0x80 | ((codepoint >> 6) & 0x3F));
+					*out++ = char(0x80 | (codepoint & 0x3F));
+				}
+				return out;
+			}
+
+			// Exact for up to 15 significant digits and |exponent| <= 22,
+			// where one multiply or divide by a power of ten rounds correctly;
+			// anything else goes through strtod
+			bool parseNumber(const char* key, std::uint32_t keyLength) {
+				static const double powers[] = {
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+				};
+
+				char* start = m_cursor;
+				bool negative = *m_cursor == '-';
+				if (negative) ++m_cursor;
+				if (m_cursor == m_end || *m_cursor < '0' || *m_cursor > '9') return fail("invalid value");
+
+				std::uint64_t mantissa = 0;
+				int digits = 0, exponent = 0;
+				bool integral = true;
+				for (; m_cursor != m_end && *m_cursor >= '0' && *m_cursor <= '9'; ++m_cursor, ++digits) {
+					mantissa = mantissa * 10 + unsigned(*m_cursor - '0');
+				}
+				if (m_cursor != m_end && *m_cursor == '.') {
+					integral = false;
+					++m_cursor;
+					if (m_cursor == m_end || *m_cursor < '0' || *m_cursor > '9') return fail("invalid number");
+					for (; m_cursor != m_end && *m_cursor >= '0' && *m_cursor <= '9'; ++m_cursor, ++digits, --exponent) {
+						mantissa = mantissa * 10 + unsigned(*m_cursor - '0');
+					}
+				}
+				if (m_cursor != m_end && (*m_cursor == 'e' || *m_cursor == 'E')) {
+					integral = false;
+					++m_cursor;
+					bool negativeExponent = false;
+					if (m_cursor != m_end && (*m_cursor == '+' || *m_cursor == '-')) {
+						negativeExponent = *m_cursor++ == '-';
+					}
+					if (m_cursor == m_end || *m_cursor < '0' || *m_cursor > '9') return fail("invalid number");
+					int value = 0;
+					for (; m_cursor != m_end && *m_cursor >= '0' && *m_cursor <= '9'; ++m_cursor) {
+						value = value < 10000 ? value * 10 + (*m_cursor - '0') : value;
+					}
+					exponent += negativeExponent ? -value : value;
+				}
+
+				double number;
+				if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+					number = exponent < 0 ? double(mantissa) / powers[-exponent] : double(mantissa) * powers[exponent];
+					if (negative) number = -number;
+				}
+				else {
+					number = std::strtod(start, nullptr);
+				}
+
+				std::uint32_t index = pushNode(Type::Number, key, keyLength);
+				m_nodes[index].number = number;
+				m_nodes[index].integral = integral;
+				m_nodes[index].next = index + 1;
+				return true;
+			}
+		};
+
+		// Deep copy into a jsoncpp value, for components that only implement
+		// Deserialize(const Json::Value&)
+		inline Json::Value ToJsonValue(const Value& value) {
+			switch (value.GetType()) {
+			case Type::Bool: return Json::Value(value.AsBool());
+			case Type::Number:
+				if (value.IsIntegral() && value.AsDouble() >= -9.2e18 && value.AsDouble() <= 9.2e18) {
+					return Json::Value(Json::Int64(value.AsDouble()));
+				}
+				return Json::Value(value.AsDouble());
+			case Type::String: return Json::Value(value.StringData(), value.StringData() + value.StringLength());
+			case Type::Array: {
+				Json::Value array(Json::arrayValue);
+				for (Value element : value) {
+					array.append(ToJsonValue(element));
+				}
+				return array;
+			}
+			case Type::Object: {
+				Json::Value object(Json::objectValue);
+				for (Value member : value) {
+					object[member.Key()] = ToJsonValue(member);
+				}
+				return object;
+			}
+			default: return Json::Value();
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryResource.h"
+
+namespace ecs {
+	// Scratch memory for one frame, with a separate bump arena per thread so
+	// allocation needs no locking. Reset() rewinds every arena at once and
+	// keeps their blocks, so steady per-frame allocation costs a pointer bump
+	// and no heap traffic. Reset() must not run concurrently with Local() or
+	// with allocation from the arenas. The per-thread arenas and their
+	// bookkeeping are allocated from the upstream resource as well.
+
+	class FrameArena {
+	public:
+		explicit FrameArena(MemoryResource* upstream = nullptr, std::size_t blockSize = 64 << 10) :
+			m_upstream{ upstream ? upstream : GetDefaultResource() }, m_blockSize{ blockSize }, m_serial{ nextSerial() } {}
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		// Arena of the calling thread, created on first use
+		MemoryResource* Local() {
+			ThreadCache& cache = threadCache();
+			if (cache.serial == m_serial) {
+				return cache.arena;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const std::thread::id thread = std::this_thread::get_id();
+			ArenaResource* arena = nullptr;
+			for (const ThreadArena& entry : m_arenas) {
+				if (entry.thread == thread) {
+					arena = entry.arena.get();
+					break;
+				}
+			}
+			if (!arena) {
+				m_arenas.reserve(m_arenas.size() + 1);
+				void* storage = m_lockedUpstream.Allocate(sizeof(ArenaResource), alignof(ArenaResource));
+				ArenaPtr created(new(storage) ArenaResource(m_blockSize, &m_lockedUpstream), ArenaDeleter{ &m_lockedUpstream });
+				m_arenas.push_back(ThreadArena{ thread, std::move(created) });
+				arena = m_arenas.back().arena.get();
+			}
+
+			cache.serial = m_serial;
+			cache.arena = arena;
+			return arena;
+		}
+
+		void Reset() noexcept {
+			for (ThreadArena& entry : m_arenas) {
+				entry.arena->Reset();
+			}
+		}
+
+		std::size_t ThreadCount() const noexcept {
+			return m_arenas.size();
+		}
+
+		// Bytes handed out since the last Reset(), over all threads
+		std::size_t BytesAllocated() const noexcept {
+			std::size_t total = 0;
+			for (const ThreadArena& entry : m_arenas) {
+				total += entry.arena->BytesAllocated();
+			}
+			return total;
+		}
+
+		std::size_t BytesReserved() const noexcept {
+			std::size_t total = 0;
+			for (const ThreadArena& entry : m_arenas) {
+				total += entry.arena->BytesReserved();
+			}
+			return total;
+		}
+
+	private:
+		// Arenas of different threads may grow at the same time, and the
+		// upstream resource, e.g. the world's own arena, need not be thread
+		// safe. Growth is rare, so a lock around it is cheap.
+		struct ArenaDeleter {
+			MemoryResource* resource;
+
+			void operator()(ArenaResource* arena) const noexcept {
+				arena->~ArenaResource();
+				resource->Deallocate(arena, sizeof(ArenaResource), alignof(ArenaResource));
+			}
+		};
+		using ArenaPtr = std::unique_ptr<ArenaResource, ArenaDeleter>;
+
+		struct ThreadArena {
+			std::thread::id thread;
+			ArenaPtr arena;
+		};
+
+		// Last frame arena looked up by this thread. Serials are never
+		// reused, so an entry left behind by a destroyed FrameArena can not
+		// match a later one at the same address.
+		struct ThreadCache {
+			std::uint64_t serial;
+			ArenaResource* arena;
+		};
+
+		MemoryResource* m_upstream;
+		std::size_t m_blockSize;
+		std::uint64_t m_serial;
+		LockedResource m_lockedUpstream{ m_upstream };
+		std::mutex m_mutex;
+		std::vector<ThreadArena, TResourceAllocator<ThreadArena>> m_arenas{ TResourceAllocator<ThreadArena>(&m_lockedUpstream) };
+
+		static std::uint64_t nextSerial() noexcept {
+			static std::atomic<std::uint64_t> serial{ 0 };
+			return ++serial;
+		}
+
+		static ThreadCache& threadCache() noexcept {
+			static thread_local ThreadCache cache{ 0, nullptr };
+			return cache;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ecs {
+	// Read-only memory mapping of a whole file. Pages are loaded on first
+	// touch and shared with the OS file cache, so a warm file costs no copy.
+
+	class MappedFile {
+	public:
+		MappedFile() = default;
+
+		explicit MappedFile(const std::string& path) {
+			Open(path);
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile() {
+			Close();
+		}
+
+		// Fails for missing and empty files
+		bool Open(const std::string& path) {
+			Close();
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return false;
+			LARGE_INTEGER size;
+			HANDLE mapping = nullptr;
+			if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			}
+			CloseHandle(file);
+			if (!mapping) return false;
+			m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+			if (!m_data) return false;
+			m_size = std::size_t(size.QuadPart);
+#else
+			int file = ::open(path.c_str(), O_RDONLY);
+			if (file < 0) return false;
+			struct stat info;
+			void* data = MAP_FAILED;
+			if (::fstat(file, &info) == 0 && info.st_size > 0) {
+				data = ::mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			}
+			::close(file);
+			if (data == MAP_FAILED) return false;
+			m_data = static_cast<const char*>(data);
+			m_size = std::size_t(info.st_size);
+#endif
+			return true;
+		}
+
+		void Close() noexcept {
+			if (!m_data) return;
+#if defined(_WIN32)
+			UnmapViewOfFile(m_data);
+#else
+			::munmap(const_cast<char*>(m_data), m_size);
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		bool IsOpen() const noexcept { return m_data != nullptr; }
+		const char* Data() const noexcept { return m_data; }
+		std::size_t Size() const noexcept { return m_size; }
+
+	private:
+		const char* m_data{ nullptr };
+		std::size_t m_size{ 0 };
+	};
+}
\ No newline at end of file
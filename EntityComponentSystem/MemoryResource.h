@@ -0,0 +1,285 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ecs {
+	// Source of raw memory for the allocators used by every container inside
+	// an entity system. Mirrors the interface of std::pmr::memory_resource.
+
+	class MemoryResource {
+	public:
+		virtual ~MemoryResource() {}
+
+		void* Allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+			return DoAllocate(bytes, alignment);
+		}
+
+		void Deallocate(void* p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+			DoDeallocate(p, bytes, alignment);
+		}
+
+		bool IsEqual(const MemoryResource& other) const noexcept {
+			return this == &other || DoIsEqual(other);
+		}
+
+	protected:
+		virtual void* DoAllocate(std::size_t bytes, std::size_t alignment) = 0;
+		virtual void DoDeallocate(void* p, std::size_t bytes, std::size_t alignment) = 0;
+		virtual bool DoIsEqual(const MemoryResource&) const noexcept { return false; }
+	};
+
+	// Global heap
+
+	class HeapResource : public MemoryResource {
+	protected:
+		void* DoAllocate(std::size_t bytes, std::size_t alignment) override {
+			if (alignment <= alignof(std::max_align_t)) {
+				return ::operator new(bytes);
+			}
+			// Over-allocate and stash the original pointer in front of the block
+			void* raw = ::operator new(bytes + alignment + sizeof(void*));
+			std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + alignment - 1) & ~(alignment - 1);
+			reinterpret_cast<void**>(aligned)[-1] = raw;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		void DoDeallocate(void* p, std::size_t, std::size_t alignment) override {
+			if (alignment <= alignof(std::max_align_t)) {
+				::operator delete(p);
+			}
+			else {
+				::operator delete(reinterpret_cast<void**>(p)[-1]);
+			}
+		}
+
+		bool DoIsEqual(const MemoryResource& other) const noexcept override {
+			return dynamic_cast<const HeapResource*>(&other) != nullptr;
+		}
+	};
+
+	inline MemoryResource* GetDefaultResource() noexcept {
+		static HeapResource resource;
+		return &resource;
+	}
+
+	// Monotonic bump allocator. Deallocation is a no-op; Release() returns
+	// every block to the upstream resource at once. Can start from a caller
+	// supplied buffer, e.g. a huge page mapping.
+	//
+	// Placing a TEntitySystem and all of its storage in an arena allows the
+	// world to be discarded without running its destructor: release the
+	// arena and the whole world is gone. Allocations made from worker
+	// threads (event overflow, per-thread frame arenas) reach the arena
+	// through the world's LockedResource.
+
+	class ArenaResource : public MemoryResource {
+	public:
+		explicit ArenaResource(std::size_t blockSize = 1 << 20, MemoryResource* upstream = GetDefaultResource()) :
+			m_upstream{ upstream }, m_blockSize{ blockSize } {}
+
+		ArenaResource(void* buffer, std::size_t size, MemoryResource* upstream = GetDefaultResource()) :
+			m_upstream{ upstream }, m_blockSize{ size > 0 ? size : 1 << 20 },
+			m_initial{ static_cast<char*>(buffer) }, m_initialSize{ size },
+			m_cursor{ m_initial }, m_end{ m_initial + size } {}
+
+		ArenaResource(const ArenaResource&) = delete;
+		ArenaResource& operator=(const ArenaResource&) = delete;
+
+		~ArenaResource() { Release(); }
+
+		// Frees all upstream blocks and rewinds to the initial buffer
+		void Release() noexcept {
+			while (m_blocks) {
+				Block* next = m_blocks->next;
+				m_upstream->Deallocate(m_blocks, m_blocks->size, alignof(Block));
+				m_blocks = next;
+			}
+			m_cursor = m_initial;
+			m_end = m_initial + m_initialSize;
+			m_allocated = 0;
+		}
+
+		// Rewinds for reuse, keeping the largest block instead of returning
+		// it upstream. When the last cycle spilled into more than one region,
+		// later blocks are sized to hold the whole cycle, so a steady workload
+		// settles into a single block and stops touching the upstream resource.
+		void Reset() noexcept {
+			m_allocated = 0;
+			if (!m_blocks) {
+				m_cursor = m_initial;
+				m_end = m_initial + m_initialSize;
+				return;
+			}
+
+			if (m_blocks->next) {
+				std::size_t reserved = BytesReserved();
+				if (reserved > m_blockSize) m_blockSize = reserved;
+			}
+
+			Block* keep = m_blocks;
+			for (Block* block = m_blocks->next; block; block = block->next) {
+				if (block->size > keep->size) keep = block;
+			}
+			while (m_blocks) {
+				Block* next = m_blocks->next;
+				if (m_blocks != keep) {
+					m_upstream->Deallocate(m_blocks, m_blocks->size, alignof(Block));
+				}
+				m_blocks = next;
+			}
+
+			keep->next = nullptr;
+			m_blocks = keep;
+			m_cursor = reinterpret_cast<char*>(keep + 1);
+			m_end = reinterpret_cast<char*>(keep) + keep->size;
+		}
+
+		// Bytes handed out since construction or the last Release()/Reset()
+		std::size_t BytesAllocated() const noexcept {
+			return m_allocated;
+		}
+
+		// Bytes held by the arena, including the initial buffer
+		std::size_t BytesReserved() const noexcept {
+			std::size_t total = m_initialSize;
+			for (Block* block = m_blocks; block; block = block->next) {
+				total += block->size;
+			}
+			return total;
+		}
+
+	protected:
+		void* DoAllocate(std::size_t bytes, std::size_t alignment) override {
+			char* p = m_cursor ? align(m_cursor, alignment) : nullptr;
+			if (!p || p + bytes > m_end) {
+				grow(bytes + alignment);
+				p = align(m_cursor, alignment);
+			}
+			m_cursor = p + bytes;
+			m_allocated += bytes;
+			return p;
+		}
+
+		void DoDeallocate(void*, std::size_t, std::size_t) override {}
+
+	private:
+		struct Block {
+			Block* next;
+			std::size_t size;
+		};
+
+		MemoryResource* m_upstream;
+		std::size_t m_blockSize;
+		char* m_initial{ nullptr };
+		std::size_t m_initialSize{ 0 };
+		char* m_cursor{ nullptr };
+		char* m_end{ nullptr };
+		Block* m_blocks{ nullptr };
+		std::size_t m_allocated{ 0 };
+
+		static char* align(char* p, std::size_t alignment) noexcept {
+			std::uintptr_t value = reinterpret_cast<std::uintptr_t>(p);
+			return reinterpret_cast<char*>((value + alignment - 1) & ~(alignment - 1));
+		}
+
+		void grow(std::size_t minimum) {
+			std::size_t size = sizeof(Block) + (minimum > m_blockSize ? minimum : m_blockSize);
+			Block* block = static_cast<Block*>(m_upstream->Allocate(size, alignof(Block)));
+			block->next = m_blocks;
+			block->size = size;
+			m_blocks = block;
+			m_cursor = reinterpret_cast<char*>(block + 1);
+			m_end = reinterpret_cast<char*>(block) + size;
+		}
+	};
+
+	// Serializes access to a resource that is not thread safe, e.g. an
+	// arena shared by allocations made from several threads. Every user
+	// that may run concurrently must go through the same LockedResource.
+
+	class LockedResource : public MemoryResource {
+	public:
+		explicit LockedResource(MemoryResource* upstream) : m_upstream{ upstream } {}
+
+		LockedResource(const LockedResource&) = delete;
+		LockedResource& operator=(const LockedResource&) = delete;
+
+	protected:
+		void* DoAllocate(std::size_t bytes, std::size_t alignment) override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_upstream->Allocate(bytes, alignment);
+		}
+
+		void DoDeallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_upstream->Deallocate(p, bytes, alignment);
+		}
+
+	private:
+		MemoryResource* m_upstream;
+		std::mutex m_mutex;
+	};
+
+	// STL allocator drawing from a MemoryResource
+
+	template <typename T>
+	class TResourceAllocator {
+	public:
+		using value_type = T;
+
+		TResourceAllocator() noexcept : m_resource{ GetDefaultResource() } {}
+
+		TResourceAllocator(MemoryResource* resource) noexcept : m_resource{ resource } {}
+
+		template <typename U>
+		TResourceAllocator(const TResourceAllocator<U>& other) noexcept : m_resource{ other.Resource() } {}
+
+		T* allocate(std::size_t n) {
+			return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n) noexcept {
+			m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		MemoryResource* Resource() const noexcept {
+			return m_resource;
+		}
+
+	private:
+		MemoryResource* m_resource;
+	};
+
+	template <typename T, typename U>
+	bool operator==(const TResourceAllocator<T>& lhs, const TResourceAllocator<U>& rhs) noexcept {
+		return lhs.Resource()->IsEqual(*rhs.Resource());
+	}
+
+	template <typename T, typename U>
+	bool operator!=(const TResourceAllocator<T>& lhs, const TResourceAllocator<U>& rhs) noexcept {
+		return !(lhs == rhs);
+	}
+
+	// Builds an allocator of the Settings allocator policy, handing it the
+	// memory resource when the policy accepts one.
+
+	template <typename TAllocator>
+	TAllocator MakeAllocator(MemoryResource* resource, std::true_type) {
+		return TAllocator(resource ? resource : GetDefaultResource());
+	}
+
+	template <typename TAllocator>
+	TAllocator MakeAllocator(MemoryResource*, std::false_type) {
+		return TAllocator();
+	}
+
+	template <typename TAllocator>
+	TAllocator MakeAllocator(MemoryResource* resource) {
+		return MakeAllocator<TAllocator>(resource, std::is_constructible<TAllocator, MemoryResource*>());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace ecs {
+	struct ComponentMemoryStats {
+		// Pool storage
+		std::size_t live{ 0 };
+		std::size_t slots{ 0 };
+		std::size_t reservedBytes{ 0 };
+		std::size_t usedBytes{ 0 };
+
+		// Entity -> pool index lookup table
+		std::size_t indexTableBytes{ 0 };
+
+		// Share of allocated slots that hold no component
+		double Fragmentation() const noexcept {
+			return slots ? 1.0 - double(live) / double(slots) : 0.0;
+		}
+	};
+
+	template <typename TSettings>
+	struct TMemoryStats {
+		std::array<ComponentMemoryStats, TSettings::ComponentCount> components;
+
+		std::size_t entityCount{ 0 };
+		std::size_t entityCapacity{ 0 };
+		std::size_t entitySlotBytes{ 0 };
+		std::size_t entitySlotUsedBytes{ 0 };
+		std::size_t entityIndexTableBytes{ 0 };
+		std::size_t tagColumnBytes{ 0 };
+		std::size_t eventQueueBytes{ 0 };
+		std::size_t frameArenaBytes{ 0 };
+		std::size_t sharedBytes{ 0 };
+
+		std::size_t TotalBytes() const noexcept {
+			std::size_t total = entitySlotBytes + entityIndexTableBytes + tagColumnBytes + eventQueueBytes + frameArenaBytes + sharedBytes;
+			for (const ComponentMemoryStats& component : components) {
+				total += component.reservedBytes + component.indexTableBytes;
+			}
+			return total;
+		}
+	};
+
+	// Estimates the heap footprint of a node based hash table: the bucket
+	// array plus one node per element holding the value and a next pointer.
+	template <typename THashTable>
+	std::size_t HashTableBytes(const THashTable& table) noexcept {
+		using Value = typename THashTable::value_type;
+		const std::size_t align = alignof(std::max_align_t);
+		const std::size_t node = (sizeof(void*) + sizeof(Value) + align - 1) / align * align;
+		return table.bucket_count() * sizeof(void*) + table.size() * node;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include "EntityParser.h"
+#include "ColumnarImport.h"
+#include "MappedFile.h"
+
+namespace ecs {
+	namespace EntityParser {
+
+		// Binary prototype cache layout, native byte order:
+		//	"ECSP", u32 version, u64 key, u32 prototypeCount, then per prototype
+		//	u32 nameLength, name, u32 componentCount, then per component
+		//	u32 component id and its described fields as raw values
+		//
+		// Components are stored through their ComponentFields description,
+		// which must declare itself Complete (see ComponentFields): only then
+		// does it cover everything Deserialize() sets. Prototypes using any
+		// other component are not cached.
+		static const char PrototypeCacheMagic[4] = { 'E', 'C', 'S', 'P' };
+		static const std::uint32_t PrototypeCacheVersion = 1;
+
+		namespace detail {
+			// FNV-1a
+			inline std::uint64_t hashBytes(std::uint64_t hash, const void* data, std::size_t size) noexcept {
+				const unsigned char* bytes = static_cast<const unsigned char*>(data);
+				for (std::size_t i = 0; i < size; ++i) {
+					hash = (hash ^ bytes[i]) * 1099511628211ULL;
+				}
+				return hash;
+			}
+
+			template <typename T>
+			std::uint64_t hashPod(std::uint64_t hash, const T& value) noexcept {
+				return hashBytes(hash, &value, sizeof(T));
+			}
+
+			inline std::uint64_t hashString(std::uint64_t hash, const std::string& value) noexcept {
+				return hashBytes(hashPod(hash, std::uint64_t(value.size())), value.data(), value.size());
+			}
+
+			template <typename T>
+			void appendPod(std::string& out, const T& value) {
+				out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+
+			inline void appendString(std::string& out, const std::string& value) {
+				appendPod(out, std::uint32_t(value.size()));
+				out.append(value);
+			}
+
+			// Bounds checked cursor over a mapped cache
+			struct CacheReader {
+				const char* pos;
+				const char* end;
+
+				bool Read(void* out, std::size_t size) noexcept {
+					if (std::size_t(end - pos) < size) return false;
+					std::memcpy(out, pos, size);
+					pos += size;
+					return true;
+				}
+
+				template <typename T>
+				bool ReadPod(T& value) noexcept {
+					return Read(&value, sizeof(T));
+				}
+
+				bool ReadString(std::string& value) {
+					std::uint32_t size;
+					if (!ReadPod(size) || std::size_t(end - pos) < size) return false;
+					value.assign(pos, size);
+					pos += size;
+					return true;
+				}
+			};
+
+			inline bool readFile(const std::string& path, std::string& text) {
+				std::ifstream in(path, std::ios::binary);
+				if (!in) return false;
+				in.seekg(0, std::ios::end);
+				text.resize(std::size_t(in.tellg()));
+				in.seekg(0, std::ios::beg);
+				return text.empty() || bool(in.read(&text[0], text.size()));
+			}
+		}
+
+		// Hash of the component layout of TSettings: component order, names
+		// and sizes, and the name, offset and type of every described field.
+		// Any change to it invalidates existing caches.
+		template <typename TSettings>
+		std::uint64_t PrototypeLayoutHash() {
+			std::uint64_t hash = detail::hashPod(14695981039346656037ULL, PrototypeCacheVersion);
+			TSettings::ComponentList::ForTypes([&hash](auto t) {
+				using ComponentType = TYPE_OF(t);
+				const ComponentType probe{};
+				hash = detail::hashString(hash, probe.Name());
+				hash = detail::hashPod(hash, std::uint64_t(sizeof(ComponentType)));
+				hash = detail::hashPod(hash, std::uint8_t(FieldsComplete<ComponentType>::value));
+				detail::forEachField(ComponentFields<ComponentType>::Get(), [&hash, &probe](const auto& field) {
+					using Member = typename std::remove_reference<decltype(probe.*field.member)>::type;
+					const std::uint64_t offset = std::uint64_t(reinterpret_cast<const char*>(&(probe.*field.member)) - reinterpret_cast<const char*>(&probe));
+					const std::uint8_t kind = std::uint8_t(sizeof(Member) << 2 | std::is_floating_point<Member>::value << 1 | std::is_signed<Member>::value);
+					hash = detail::hashString(hash, field.name);
+					hash = detail::hashPod(hash, offset);
+					hash = detail::hashPod(hash, kind);
+				});
+			});
+			return hash;
+		}
+
+		inline std::uint64_t PrototypeSourceHash(const std::string& source) noexcept {
+			return detail::hashString(14695981039346656037ULL, source);
+		}
+
+		// Cache key of a set of prototype sources, in load order. Sources are
+		// hashed separately so files can be hashed concurrently.
+		template <typename TSettings>
+		std::uint64_t PrototypeCacheKey(const std::vector<std::uint64_t>& sourceHashes) {
+			std::uint64_t hash = PrototypeLayoutHash<TSettings>();
+			for (std::uint64_t sourceHash : sourceHashes) {
+				hash = detail::hashPod(hash, sourceHash);
+			}
+			return hash;
+		}
+
+		template <typename TSettings>
+		std::uint64_t PrototypeCacheKey(const std::vector<std::string>& sources) {
+			std::vector<std::uint64_t> sourceHashes;
+			for (const std::string& source : sources) {
+				sourceHashes.push_back(PrototypeSourceHash(source));
+			}
+			return PrototypeCacheKey<TSettings>(sourceHashes);
+		}
+
+		// Writes the cache through a temporary file so a reader never maps
+		// a half written one. Fails, with a warning, for prototypes using a
+		// component whose description is not Complete.
+		template <typename TSettings>
+		bool WritePrototypeCache(const std::string& path, std::uint64_t key, const std::vector<TEntityPrototype<TSettings>>& prototypes,
+			PrototypeParseReport& report) {
+
+			std::string out(PrototypeCacheMagic, sizeof(PrototypeCacheMagic));
+			detail::appendPod(out, PrototypeCacheVersion);
+			detail::appendPod(out, key);
+			detail::appendPod(out, std::uint32_t(prototypes.size()));
+
+			for (const TEntityPrototype<TSettings>& proto : prototypes) {
+				detail::appendString(out, proto.GetName());
+				const std::size_t countOffset = out.size();
+				std::uint32_t componentCount = 0;
+				detail::appendPod(out, componentCount);
+
+				bool described = true;
+				TSettings::ComponentList::ForTypes([&](auto t) {
+					using ComponentType = TYPE_OF(t);
+					const ComponentType* component = proto.template Find<ComponentType>();
+					if (!component || !described) return;
+					if (!FieldsComplete<ComponentType>::value) {
+						report.warnings.push_back(proto.GetName() + ": " + component->Name() + " has no Complete ComponentFields description, prototype cache not written");
+						described = false;
+						return;
+					}
+					detail::appendPod(out, std::uint32_t(TSettings::template ComponentId<ComponentType>()));
+					detail::forEachField(ComponentFields<ComponentType>::Get(), [&out, component](const auto& field) {
+						detail::appendPod(out, component->*field.member);
+					});
+					++componentCount;
+				});
+				if (!described) return false;
+				std::memcpy(&out[countOffset], &componentCount, sizeof(componentCount));
+			}
+
+			const std::string temporary = path + ".tmp";
+			{
+				std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+				if (!file.write(out.data(), out.size())) {
+					report.warnings.push_back(path + ": prototype cache could not be written");
+					return false;
+				}
+			}
+			std::remove(path.c_str());
+			if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+				std::remove(temporary.c_str());
+				report.warnings.push_back(path + ": prototype cache could not be written");
+				return false;
+			}
+			return true;
+		}
+
+		// Reads prototypes straight from the mapped cache. Returns false,
+		// leaving `prototypes` empty, when the cache is missing, was written
+		// for another key, or is malformed.
+		template <typename TSettings>
+		bool ReadPrototypeCache(const std::string& path, std::uint64_t key, std::vector<TEntityPrototype<TSettings>>& prototypes,
+			MemoryResource* resource = nullptr) {
+
+			prototypes.clear();
+			MappedFile file;
+			if (!file.Open(path)) return false;
+
+			detail::CacheReader reader{ file.Data(), file.Data() + file.Size() };
+			char magic[4];
+			std::uint32_t version, prototypeCount;
+			std::uint64_t cacheKey;
+			if (!reader.Read(magic, sizeof(magic)) || std::memcmp(magic, PrototypeCacheMagic, sizeof(magic)) != 0 ||
+				!reader.ReadPod(version) || version != PrototypeCacheVersion ||
+				!reader.ReadPod(cacheKey) || cacheKey != key || !reader.ReadPod(prototypeCount)) {
+				return false;
+			}
+
+			prototypes.reserve(prototypeCount);
+			std::string name;
+			for (std::uint32_t p = 0; p < prototypeCount; ++p) {
+				std::uint32_t componentCount;
+				if (!reader.ReadString(name) || !reader.ReadPod(componentCount)) {
+					prototypes.clear();
+					return false;
+				}
+
+				TEntityPrototype<TSettings> proto(name, resource);
+				for (std::uint32_t c = 0; c < componentCount; ++c) {
+					std::uint32_t id;
+					bool read = false;
+					if (reader.ReadPod(id)) {
+						TSettings::ComponentList::ForTypes([&](auto t) {
+							using ComponentType = TYPE_OF(t);
+							if (TSettings::template ComponentId<ComponentType>() != id || !FieldsComplete<ComponentType>::value) return;
+							ComponentType component;
+							read = true;
+							detail::forEachField(ComponentFields<ComponentType>::Get(), [&reader, &read, &component](const auto& field) {
+								read = read && reader.ReadPod(component.*field.member);
+							});
+							if (read) proto.Add(std::move(component));
+						});
+					}
+					if (!read) {
+						prototypes.clear();
+						return false;
+					}
+				}
+				prototypes.push_back(std::move(proto));
+			}
+
+			if (reader.pos != reader.end) {
+				prototypes.clear();
+				return false;
+			}
+			return true;
+		}
+
+		namespace detail {
+			// One prototype file while loading. Errors stay with the file
+			// until the files are merged, in order, on the calling thread.
+			struct PrototypeFile {
+				std::string text;
+				std::uint64_t hash{ 0 };
+				bool read{ false };
+				FastJson::Document document;
+				std::vector<PrototypeSource<FastJson::Value>> sources;
+				PrototypeParseReport report;
+			};
+		}
+
+		// Loads the prototypes of several files, each an object of
+		// prototypes as taken by ParseTypes(), resolved together so a base
+		// may live in another file. When `cachePath` names a cache built
+		// from the same file contents and component layout it is used
+		// instead of parsing; otherwise the files are parsed and, if they
+		// load without errors, the cache is rewritten.
+		//
+		// With a pool, files are read, hashed and parsed concurrently and
+		// prototypes are built concurrently as in ParseTypes(). The result
+		// does not depend on scheduling: prototypes come in file order, then
+		// document order, and a name defined again, in the same or a later
+		// file, is reported and the first definition kept.
+		template <typename TSettings>
+		static std::vector<TEntityPrototype<TSettings>> LoadPrototypes(const std::vector<std::string>& paths, const std::string& cachePath,
+			PrototypeParseReport& report, ThreadPool* pool = nullptr, MemoryResource* resource = nullptr) {
+
+			const std::size_t errors = report.errors.size();
+			std::vector<TEntityPrototype<TSettings>> prototypes;
+			std::vector<detail::PrototypeFile> files(paths.size());
+			auto forFiles = [pool, &files](auto&& func) {
+				if (pool) {
+					pool->ParallelFor(files.size(), func);
+				}
+				else {
+					for (std::size_t i = 0; i < files.size(); ++i) func(i);
+				}
+			};
+
+			forFiles([&files, &paths](std::size_t i) {
+				detail::PrototypeFile& file = files[i];
+				file.read = detail::readFile(paths[i], file.text);
+				file.hash = file.read ? PrototypeSourceHash(file.text) : 0;
+			});
+
+			std::vector<std::uint64_t> sourceHashes;
+			for (std::size_t i = 0; i < files.size(); ++i) {
+				if (!files[i].read) {
+					report.errors.push_back(paths[i] + ": could not be read");
+				}
+				sourceHashes.push_back(files[i].hash);
+			}
+			if (report.errors.size() != errors) return prototypes;
+
+			const std::uint64_t key = PrototypeCacheKey<TSettings>(sourceHashes);
+			if (!cachePath.empty() && ReadPrototypeCache<TSettings>(cachePath, key, prototypes, resource)) {
+				report.fromCache = true;
+				report.prototypes += prototypes.size();
+				return prototypes;
+			}
+
+			// Documents parse the texts in place and must outlive the sources
+			forFiles([&files, &paths](std::size_t i) {
+				detail::PrototypeFile& file = files[i];
+				if (!file.document.ParseInSitu(&file.text[0], file.text.size())) {
+					file.report.errors.push_back(paths[i] + ": " + file.document.GetError());
+					return;
+				}
+				file.sources.reserve(file.document.Root().Size());
+				for (FastJson::Value typeRoot : file.document.Root()) {
+					if (typeRoot.IsObject()) {
+						addSource(file.sources, typeRoot.Key(), typeRoot, file.report, paths[i]);
+					}
+				}
+			});
+
+			std::vector<PrototypeSource<FastJson::Value>> sources;
+			for (detail::PrototypeFile& file : files) {
+				report.errors.insert(report.errors.end(), file.report.errors.begin(), file.report.errors.end());
+				sources.insert(sources.end(), std::make_move_iterator(file.sources.begin()), std::make_move_iterator(file.sources.end()));
+			}
+
+			prototypes = resolvePrototypes<TSettings>(sources, report, pool, resource);
+			if (!cachePath.empty() && report.errors.size() == errors) {
+				WritePrototypeCache<TSettings>(cachePath, key, prototypes, report);
+			}
+			return prototypes;
+		}
+
+	}
+}
\ No newline at end of file
@@ -1,163 +1,278 @@
-#pragma once
-
-#include <bitset>
-#include "Reflection.h"
-#include "Component.h"
-
-namespace ecs {
-	namespace Sig {
-		template<typename TSettings>
-		struct SignatureBitset;
-
-		template<typename TSettings>
-		struct SignatureBitsetStorage;
-	}
-
-	template
-		<
-		typename TComponentList,
-		typename TTagList,
-		typename TSignatureList
-		>
-		struct Settings {
-
-		using ComponentList = TComponentList;
-		using TagList = TTagList;
-		using SignatureList = TSignatureList;
-		using ThisType = Settings<ComponentList, TagList, SignatureList>;
-
-		using SignatureBitset = Sig::SignatureBitset<ThisType>;
-		using SignatureBitsetStorage = Sig::SignatureBitsetStorage<ThisType>;
-
-		// Count of various types
-
-		static constexpr std::size_t ComponentCount = ComponentList::Size;
-
-		static constexpr std::size_t TagCount = TagList::Size;
-
-		static constexpr std::size_t SignatureCount = SignatureList::Size;
-
-		// Check type "traits"
-
-		template <typename T>
-		static constexpr bool IsComponent() noexcept {
-			return ComponentList::Contains<T>()
-				&& std::is_base_of<Component, T>::value
-				&& !std::is_same<Component, T>::value;
-		}
-
-		template <typename T>
-		static constexpr bool IsTag() noexcept {
-			return TagList::Contains<T>();
-		}
-
-		template <typename T>
-		static constexpr bool IsSignature() noexcept {
-			return SignatureList::Contains<T>();
-		}
-
-		// Unique ID for each type
-
-		template <typename T>
-		static constexpr std::size_t ComponentId() noexcept {
-			return ComponentList::IndexOf<T>();
-		}
-
-		template <typename T>
-		static constexpr std::size_t TagId() noexcept {
-			return TagList::IndexOf<T>();
-		}
-
-		template <typename T>
-		static constexpr std::size_t SignatureId() noexcept {
-			return SignatureList::IndexOf<T>();
-		}
-
-		// Bitset type and indexing
-
-		using Bitset = std::bitset<ComponentCount + TagCount>;
-
-		template <typename T>
-		static constexpr std::size_t ComponentBit() noexcept {
-			return ComponentId<T>();
-		}
-
-		template <typename T>
-		static constexpr std::size_t TagBit() noexcept {
-			return ComponentCount + TagId<T>();
-		}
-	};
-
-	namespace Sig {
-		template <typename TSettings>
-		struct SignatureBitset {
-			using Settings = TSettings;
-			using ThisType = SignatureBitset<Settings>;
-			using SignatureList = typename Settings::SignatureList;
-			using Bitset = typename Settings::Bitset;
-
-			using BitsetStorage = Refl::Repeat<Settings::SignatureCount, Bitset>;
-
-			template <typename T>
-			using IsComponentFilter = std::integral_constant<bool, Settings::template IsComponent<T>()>;
-
-			template <typename T>
-			using IsTagFilter = std::integral_constant<bool, Settings::template IsTag<T>()>;
-
-			template <typename TSignature>
-			using SignatureComponents = typename TSignature::template Filter<IsComponentFilter>;
-
-			template <typename TSignature>
-			using SignatureTags = typename TSignature::template Filter<IsTagFilter>;
-		};
-
-		template <typename TSettings>
-		struct SignatureBitsetStorage {
-		private:
-			using Settings = TSettings;
-			using SignatureBitset = typename Settings::SignatureBitset;
-			using SignatureList = typename SignatureBitset::SignatureList;
-			using BitsetStorage = typename SignatureBitset::BitsetStorage;
-
-			BitsetStorage m_storage;
-
-		public:
-			SignatureBitsetStorage() noexcept {
-				SignatureList::ForTypes([this](auto t) {
-					this->InitBitset<TYPE_OF(t)>();
-				});
-			}
-
-			template <typename T>
-			auto& GetSignatureBitset() noexcept {
-				static_assert(Settings::template IsSignature<T>(), "");
-
-				return std::get<Settings::template SignatureId<T>()>(m_storage);
-			}
-
-			template <typename T>
-			const auto& GetSignatureBitset() const noexcept {
-				static_assert(Settings::template IsSignature<T>(), "");
-
-				return std::get<Settings::template SignatureId<T>()>(m_storage);
-			}
-
-		private:
-			template <typename T>
-			void InitBitset() noexcept {
-				auto& bitset(this->GetSignatureBitset<T>());
-
-				using SignatureComponents = typename SignatureBitset::template SignatureComponents<T>;
-				using SignatureTags = typename SignatureBitset::template SignatureTags<T>;
-
-				SignatureComponents::ForTypes([this, &bitset](auto t) {
-					bitset[Settings::template ComponentBit<TYPE_OF(t)>()] = true;
-				});
-
-				SignatureTags::ForTypes([this, &bitset](auto t) {
-					bitset[Settings::template TagBit<TYPE_OF(t)>()] = true;
-				});
-			}
-		};
-	}
-}
+#pragma once
+
+#include <bitset>
+#include <memory>
+#include "Reflection.h"
+#include "Entity.h"
+#include "Component.h"
+#include "MemoryResource.h"
+
+namespace ecs {
+	namespace Sig {
+		template<typename TSettings>
+		struct SignatureBitset;
+
+		template<typename TSettings>
+		struct SignatureBitsetStorage;
+	}
+
+	// Optional features of an entity system. Derive from this and override
+	// members to turn features on, then pass the result to Settings.
+
+	struct DefaultOptions {
+		// Record per-query and per-frame statistics (see TProfiler.h)
+		static constexpr bool EnableProfiling = false;
+
+		// Allocator used by every container of an entity system. When it can
+		// be constructed from a MemoryResource*, the resource given to the
+		// TEntitySystem constructor is passed on (see TResourceAllocator).
+		template <typename T>
+		using Allocator = std::allocator<T>;
+
+		// Global data (clocks, configuration) stored once per entity system
+		// instead of as components of a dedicated entity. Types must be
+		// default constructible (see TEntitySystem::GetSingleton).
+		using SingletonList = Refl::TypeList<>;
+
+		// Event types exchanged between systems through double-buffered
+		// queues swapped on Refresh() (see TEventQueue.h)
+		using EventList = Refl::TypeList<>;
+
+		// Immutable data shared by many entities, e.g. mesh ids or stat
+		// tables. Each distinct value is stored once, found by std::hash<T>
+		// and operator==, and entities hold a 32-bit handle to it (see
+		// TSharedStore.h). Types need not derive from Component.
+		using SharedList = Refl::TypeList<>;
+
+		// Signatures made of components only whose storage is kept grouped:
+		// the components of every matching entity are packed at the front of
+		// each pool in the same order, so TEntitySystem::ForGroup walks them
+		// as parallel arrays. A component can belong to one group at most.
+		using GroupList = Refl::TypeList<>;
+
+		// Components kept densely packed: removal moves the last component
+		// into the hole, so storage has no gaps and can be walked as arrays
+		// (see TEntitySystem::ForComponentSpans)
+		using DenseList = Refl::TypeList<>;
+
+		// Entity handle type, e.g. CompactEntity for 32-bit handles with
+		// reused slots (see Entity.h)
+		using EntityHandle = Entity;
+	};
+
+	template
+		<
+		typename TComponentList,
+		typename TTagList,
+		typename TSignatureList,
+		typename TOptions = DefaultOptions
+		>
+		struct Settings {
+
+		using ComponentList = TComponentList;
+		using TagList = TTagList;
+		using SignatureList = TSignatureList;
+		using Options = TOptions;
+		using SingletonList = typename Options::SingletonList;
+		using EventList = typename Options::EventList;
+		using DenseList = typename Options::DenseList;
+		using SharedList = typename Options::SharedList;
+		using GroupList = typename Options::GroupList;
+		using Entity = typename Options::EntityHandle;
+		using ThisType = Settings<ComponentList, TagList, SignatureList, Options>;
+
+		using SignatureBitset = Sig::SignatureBitset<ThisType>;
+		using SignatureBitsetStorage = Sig::SignatureBitsetStorage<ThisType>;
+
+		// Count of various types
+
+		static constexpr std::size_t ComponentCount = ComponentList::Size;
+
+		static constexpr std::size_t TagCount = TagList::Size;
+
+		static constexpr std::size_t SignatureCount = SignatureList::Size;
+
+		static constexpr std::size_t SingletonCount = SingletonList::Size;
+
+		static constexpr std::size_t EventCount = EventList::Size;
+
+		static constexpr std::size_t SharedCount = SharedList::Size;
+
+		static constexpr std::size_t GroupCount = GroupList::Size;
+
+		// Enabled features
+
+		static constexpr bool ProfilingEnabled = Options::EnableProfiling;
+
+		template <typename T>
+		using Allocator = typename Options::template Allocator<T>;
+
+		// Check type "traits"
+
+		template <typename T>
+		static constexpr bool IsComponent() noexcept {
+			return ComponentList::template Contains<T>()
+				&& std::is_base_of<Component, T>::value
+				&& !std::is_same<Component, T>::value;
+		}
+
+		template <typename T>
+		static constexpr bool IsTag() noexcept {
+			return TagList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsSignature() noexcept {
+			return SignatureList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsSingleton() noexcept {
+			return SingletonList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsEvent() noexcept {
+			return EventList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsShared() noexcept {
+			return SharedList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsGroup() noexcept {
+			return GroupList::template Contains<T>();
+		}
+
+		template <typename T>
+		static constexpr bool IsDense() noexcept {
+			return IsComponent<T>() && DenseList::template Contains<T>();
+		}
+
+		// Unique ID for each type
+
+		template <typename T>
+		static constexpr std::size_t ComponentId() noexcept {
+			return ComponentList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t TagId() noexcept {
+			return TagList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t SignatureId() noexcept {
+			return SignatureList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t SingletonId() noexcept {
+			return SingletonList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t EventId() noexcept {
+			return EventList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t SharedId() noexcept {
+			return SharedList::template IndexOf<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t GroupId() noexcept {
+			return GroupList::template IndexOf<T>();
+		}
+
+		// Bitset type and indexing
+
+		using Bitset = std::bitset<ComponentCount + TagCount>;
+
+		template <typename T>
+		static constexpr std::size_t ComponentBit() noexcept {
+			return ComponentId<T>();
+		}
+
+		template <typename T>
+		static constexpr std::size_t TagBit() noexcept {
+			return ComponentCount + TagId<T>();
+		}
+	};
+
+	namespace Sig {
+		template <typename TSettings>
+		struct SignatureBitset {
+			using Settings = TSettings;
+			using ThisType = SignatureBitset<Settings>;
+			using SignatureList = typename Settings::SignatureList;
+			using Bitset = typename Settings::Bitset;
+
+			using BitsetStorage = Refl::Repeat<Settings::SignatureCount, Bitset>;
+
+			template <typename T>
+			using IsComponentFilter = std::integral_constant<bool, Settings::template IsComponent<T>()>;
+
+			template <typename T>
+			using IsTagFilter = std::integral_constant<bool, Settings::template IsTag<T>()>;
+
+			template <typename TSignature>
+			using SignatureComponents = typename TSignature::template Filter<IsComponentFilter>;
+
+			template <typename TSignature>
+			using SignatureTags = typename TSignature::template Filter<IsTagFilter>;
+		};
+
+		template <typename TSettings>
+		struct SignatureBitsetStorage {
+		private:
+			using Settings = TSettings;
+			using SignatureBitset = typename Settings::SignatureBitset;
+			using SignatureList = typename SignatureBitset::SignatureList;
+			using BitsetStorage = typename SignatureBitset::BitsetStorage;
+
+			BitsetStorage m_storage;
+
+		public:
+			SignatureBitsetStorage() noexcept {
+				SignatureList::ForTypes([this](auto t) {
+					this->InitBitset<TYPE_OF(t)>();
+				});
+			}
+
+			template <typename T>
+			auto& GetSignatureBitset() noexcept {
+				static_assert(Settings::template IsSignature<T>(), "");
+
+				return std::get<Settings::template SignatureId<T>()>(m_storage);
+			}
+
+			template <typename T>
+			const auto& GetSignatureBitset() const noexcept {
+				static_assert(Settings::template IsSignature<T>(), "");
+
+				return std::get<Settings::template SignatureId<T>()>(m_storage);
+			}
+
+		private:
+			template <typename T>
+			void InitBitset() noexcept {
+				auto& bitset(this->GetSignatureBitset<T>());
+
+				using SignatureComponents = typename SignatureBitset::template SignatureComponents<T>;
+				using SignatureTags = typename SignatureBitset::template SignatureTags<T>;
+
+				SignatureComponents::ForTypes([this, &bitset](auto t) {
+					bitset[Settings::template ComponentBit<TYPE_OF(t)>()] = true;
+				});
+
+				SignatureTags::ForTypes([this, &bitset](auto t) {
+					bitset[Settings::template TagBit<TYPE_OF(t)>()] = true;
+				});
+			}
+		};
+	}
+}
\ No newline at end of file
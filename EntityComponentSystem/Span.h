@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+
+namespace ecs {
+	// Non-owning view of a contiguous run of objects
+
+	template <typename T>
+	class TSpan {
+	public:
+		TSpan() noexcept : m_data{ nullptr }, m_size{ 0 } {}
+
+		TSpan(T* data, std::size_t size) noexcept : m_data{ data }, m_size{ size } {}
+
+		T* data() const noexcept { return m_data; }
+		std::size_t size() const noexcept { return m_size; }
+		bool empty() const noexcept { return m_size == 0; }
+
+		T& operator[](std::size_t i) const noexcept { return m_data[i]; }
+
+		T* begin() const noexcept { return m_data; }
+		T* end() const noexcept { return m_data + m_size; }
+
+	private:
+		T* m_data;
+		std::size_t m_size;
+	};
+
+	// Hints the cache to load the line holding `p`
+
+	inline void Prefetch(const void* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+		(void)p;
+#endif
+	}
+}
\ No newline at end of file
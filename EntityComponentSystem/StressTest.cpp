@@ -0,0 +1,406 @@
+// Randomized stress tester. Applies random create/kill/add/remove/tag/
+// sort/defragment/reserve/Clear/Refresh sequences to an entity system and to a plain
+// reference model, and checks that both agree after every Refresh() and Clear().
+//
+// Usage: ecs_stress [--seed=N] [--ops=N] [--entities=N]
+
+#include <map>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include "TestComponents.h"
+
+namespace {
+	using namespace ecs;
+	using namespace ecs::test;
+
+	// Health uses dense storage, Position the sparse pool, and both are
+	// owned by the S1 group
+	struct StressSettingsOptions : DenseOptions {
+		using GroupList = Refl::TypeList<S1>;
+	};
+
+	using EntitySystem = TEntitySystem<Settings<MyComponentList, MyTagList, MySignatureList, StressSettingsOptions>>;
+
+	struct ModelEntity {
+		bool killed{ false };
+		bool hasPosition{ false };
+		float x{ 0 };
+		bool hasHealth{ false };
+		float health{ 0 };
+		bool tagged{ false };
+	};
+
+	struct StressOptions {
+		unsigned seed{ 1 };
+		std::size_t ops{ 100000 };
+		std::size_t entities{ 2000 };
+	};
+
+	bool ParseOption(const char* arg, const char* name, std::string& value) {
+		std::size_t length = std::strlen(name);
+		if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+			value = arg + length + 1;
+			return true;
+		}
+		return false;
+	}
+
+	class StressTest {
+	public:
+		explicit StressTest(const StressOptions& options) : m_options{ options }, m_rng{ options.seed } {}
+
+		bool Run() {
+			using Clock = std::chrono::steady_clock;
+			Clock::time_point start = Clock::now();
+			double verifySeconds = 0;
+			std::size_t refreshes = 0;
+
+			for (m_op = 0; m_op < m_options.ops; ++m_op) {
+				std::uniform_int_distribution<int> pick(0, 99);
+				int op = pick(m_rng);
+
+				if (op < 20) create();
+				else if (op < 30) kill();
+				else if (op < 42) addPosition();
+				else if (op < 48) removePosition();
+				else if (op < 60) addHealth();
+				else if (op < 66) removeHealth();
+				else if (op < 78) modify();
+				else if (op < 90) toggleTag();
+				else if (op < 91) sortPositions();
+				else if (op < 92) m_system.ShrinkToFit();
+				else if (op < 93) m_system.DefragmentAll(64);
+				else if (op < 94) reserve();
+				else if (op < 95) materialize();
+				else if (op < 96) {
+					// Rare, so the world gets to grow between clears
+					if (std::uniform_int_distribution<int>(0, 99)(m_rng) != 0) continue;
+					clear();
+					if (!verify()) return false;
+				}
+				else {
+					refresh();
+					++refreshes;
+					Clock::time_point verifyStart = Clock::now();
+					if (!verify()) return false;
+					verifySeconds += std::chrono::duration<double>(Clock::now() - verifyStart).count();
+				}
+			}
+
+			refresh();
+			if (!verify()) return false;
+
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			std::cout << "Stress test passed: " << m_options.ops << " ops, " << refreshes << " refreshes, seed " << m_options.seed << std::endl;
+			std::cout << "  total " << seconds * 1e3 << " ms, verification " << verifySeconds * 1e3 << " ms, "
+				<< (seconds - verifySeconds) / double(m_options.ops) * 1e9 << " ns/op" << std::endl;
+			return true;
+		}
+
+	private:
+		StressOptions m_options;
+		std::mt19937 m_rng;
+		std::size_t m_op{ 0 };
+
+		EntitySystem m_system;
+		std::map<Entity, ModelEntity> m_model;
+		std::vector<Entity> m_handles;
+		std::vector<Entity> m_destroyed;
+		std::vector<Entity> m_reserved;
+
+		Entity randomHandle() {
+			std::uniform_int_distribution<std::size_t> pick(0, m_handles.size() - 1);
+			return m_handles[pick(m_rng)];
+		}
+
+		float randomValue() {
+			return float(std::uniform_int_distribution<int>(0, 1000)(m_rng));
+		}
+
+		void create() {
+			if (m_model.size() >= m_options.entities) return;
+			Entity e = m_system.CreateEntity();
+			m_model[e] = ModelEntity();
+			m_handles.push_back(e);
+		}
+
+		void reserve() {
+			std::size_t count = std::uniform_int_distribution<std::size_t>(0, 3)(m_rng);
+			if (m_model.size() + m_reserved.size() + count > m_options.entities) return;
+			if (count == 0) {
+				m_reserved.push_back(m_system.ReserveEntity());
+			}
+			else {
+				m_system.ReserveEntities(count, m_reserved);
+			}
+		}
+
+		// Reserved handles become entities that Refresh() then makes visible
+		void materialize() {
+			m_system.MaterializeReserved();
+			for (Entity e : m_reserved) {
+				m_model[e] = ModelEntity();
+				m_handles.push_back(e);
+			}
+			m_reserved.clear();
+		}
+
+		// Kills made since the last Refresh() are still pending here
+		void clear() {
+			m_system.Clear();
+			for (const auto& entry : m_model) {
+				m_destroyed.push_back(entry.first);
+			}
+			m_destroyed.insert(m_destroyed.end(), m_reserved.begin(), m_reserved.end());
+			m_model.clear();
+			m_handles.clear();
+			m_reserved.clear();
+		}
+
+		void kill() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			m_system.Kill(e);
+			m_model[e].killed = true;
+		}
+
+		void addPosition() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (model.hasPosition) return;
+			PositionComponent position;
+			position.x = model.x = randomValue();
+			position.y = position.z = 0;
+			m_system.AddComponent(e, position);
+			model.hasPosition = true;
+		}
+
+		void removePosition() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (!model.hasPosition) return;
+			m_system.RemoveComponent<PositionComponent>(e);
+			model.hasPosition = false;
+		}
+
+		void addHealth() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (model.hasHealth) return;
+			HealthComponent health;
+			health.health = model.health = randomValue();
+			health.maxHealth = 1000;
+			m_system.AddComponent(e, health);
+			model.hasHealth = true;
+		}
+
+		void removeHealth() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (!model.hasHealth) return;
+			m_system.RemoveComponent<HealthComponent>(e);
+			model.hasHealth = false;
+		}
+
+		void modify() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (model.hasPosition) {
+				m_system.GetComponent<PositionComponent>(e).x = model.x = randomValue();
+			}
+			if (model.hasHealth) {
+				m_system.GetComponent<HealthComponent>(e).health = model.health = randomValue();
+			}
+		}
+
+		void toggleTag() {
+			if (m_handles.empty()) return;
+			Entity e = randomHandle();
+			ModelEntity& model = m_model[e];
+			if (model.tagged) {
+				m_system.RemoveTag<T0>(e);
+			}
+			else {
+				m_system.AddTag<T0>(e);
+			}
+			model.tagged = !model.tagged;
+		}
+
+		void sortPositions() {
+			bool reorderEntities = std::uniform_int_distribution<int>(0, 1)(m_rng) != 0;
+			m_system.SortComponents<PositionComponent>([](const PositionComponent& a, const PositionComponent& b) {
+				return a.x < b.x;
+			}, ComponentSortMode::Full, reorderEntities);
+		}
+
+		void refresh() {
+			materialize();
+			m_system.Refresh();
+			for (auto iter = m_model.begin(); iter != m_model.end();) {
+				if (iter->second.killed) {
+					m_destroyed.push_back(iter->first);
+					iter = m_model.erase(iter);
+				}
+				else {
+					++iter;
+				}
+			}
+			m_handles.clear();
+			for (const auto& entry : m_model) {
+				m_handles.push_back(entry.first);
+			}
+			if (m_destroyed.size() > 1000) {
+				m_destroyed.erase(m_destroyed.begin(), m_destroyed.begin() + 500);
+			}
+		}
+
+		bool fail(const std::string& message) {
+			std::cerr << "Mismatch after op " << m_op << " (seed " << m_options.seed << "): " << message << std::endl;
+			return false;
+		}
+
+		bool verify() {
+			std::size_t visited = 0, matched = 0, tagged = 0;
+			bool ok = true;
+			m_system.ForEntities([&](EntityIndex index) {
+				Entity e = m_system.GetEntity(index);
+				++visited;
+				if (m_model.find(e) == m_model.end()) {
+					ok = fail("unexpected entity " + std::to_string(e.id));
+				}
+			});
+			if (!ok) return false;
+			if (visited != m_model.size()) {
+				return fail("entity count " + std::to_string(visited) + " != " + std::to_string(m_model.size()));
+			}
+
+			std::size_t expectedMatched = 0, expectedTagged = 0;
+			for (const auto& entry : m_model) {
+				Entity e = entry.first;
+				const ModelEntity& model = entry.second;
+				if (!m_system.IsHandleValid(e) || !m_system.IsAlive(e)) {
+					return fail("entity " + std::to_string(e.id) + " lost");
+				}
+				if (m_system.HasComponent<PositionComponent>(e) != model.hasPosition ||
+					m_system.HasComponent<HealthComponent>(e) != model.hasHealth ||
+					m_system.HasTag<T0>(e) != model.tagged) {
+					return fail("signature of entity " + std::to_string(e.id));
+				}
+				if (model.hasPosition && m_system.GetComponent<PositionComponent>(e).x != model.x) {
+					return fail("position of entity " + std::to_string(e.id));
+				}
+				if (model.hasHealth && m_system.GetComponent<HealthComponent>(e).health != model.health) {
+					return fail("health of entity " + std::to_string(e.id));
+				}
+				expectedMatched += model.hasPosition && model.hasHealth;
+				expectedTagged += model.tagged;
+			}
+
+			m_system.ForEntitiesMatching<S1>([&matched](EntityIndex, PositionComponent&, HealthComponent&) { ++matched; });
+			if (matched != expectedMatched) {
+				return fail("S1 matched " + std::to_string(matched) + " != " + std::to_string(expectedMatched));
+			}
+
+			std::size_t chunked = 0;
+			m_system.ForChunks<S1, 64>([&chunked](TSpan<const EntityIndex> indices, TSpan<PositionComponent>, TSpan<HealthComponent>) {
+				chunked += indices.size();
+			});
+			if (chunked != expectedMatched) {
+				return fail("S1 chunked " + std::to_string(chunked) + " != " + std::to_string(expectedMatched));
+			}
+
+			std::size_t grouped = 0;
+			m_system.ForGroup<S1>([this, &grouped, &ok](Entity e, PositionComponent& position, HealthComponent& health) {
+				auto found = m_model.find(e);
+				if (found == m_model.end() || found->second.x != position.x || found->second.health != health.health) {
+					ok = false;
+				}
+				++grouped;
+			});
+			if (!ok || grouped != expectedMatched) {
+				return fail("S1 group " + std::to_string(grouped) + " != " + std::to_string(expectedMatched));
+			}
+
+			std::size_t dense = 0, expectedDense = 0;
+			m_system.ForComponentSpans<HealthComponent>([this, &dense, &ok](TSpan<const Entity> owners, TSpan<HealthComponent> components) {
+				for (std::size_t i = 0; i < components.size(); ++i) {
+					auto found = m_model.find(owners[i]);
+					if (found == m_model.end() || !found->second.hasHealth || found->second.health != components[i].health) {
+						ok = false;
+					}
+				}
+				dense += components.size();
+			});
+			for (const auto& entry : m_model) {
+				expectedDense += entry.second.hasHealth;
+			}
+			if (!ok || dense != expectedDense) {
+				return fail("dense Health spans");
+			}
+
+			std::size_t expectedPositions = 0, positions = 0, healths = 0;
+			for (const auto& entry : m_model) {
+				expectedPositions += entry.second.hasPosition;
+			}
+			m_system.ForEachComponent<PositionComponent>([this, &positions, &ok](Entity owner, PositionComponent& position) {
+				auto found = m_model.find(owner);
+				if (found == m_model.end() || !found->second.hasPosition || found->second.x != position.x) {
+					ok = false;
+				}
+				++positions;
+			});
+			m_system.ForEachComponent<HealthComponent>([this, &healths, &ok](Entity owner, HealthComponent&) {
+				ok = ok && m_model.find(owner) != m_model.end();
+				++healths;
+			});
+			if (!ok || positions != expectedPositions || healths != expectedDense) {
+				return fail("component storage owners");
+			}
+
+			tagged = m_system.CountTagged<T0>();
+			if (tagged != expectedTagged) {
+				return fail("T0 count " + std::to_string(tagged) + " != " + std::to_string(expectedTagged));
+			}
+
+			for (Entity e : m_destroyed) {
+				if (m_system.IsHandleValid(e)) {
+					return fail("destroyed entity " + std::to_string(e.id) + " still valid");
+				}
+			}
+			return true;
+		}
+	};
+}
+
+int main(int argc, char** argv) {
+	StressOptions options;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string value;
+		if (ParseOption(argv[i], "--seed", value)) {
+			options.seed = unsigned(std::strtoul(value.c_str(), nullptr, 10));
+		}
+		else if (ParseOption(argv[i], "--ops", value)) {
+			options.ops = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--entities", value)) {
+			options.entities = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else {
+			std::cerr << "Unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	StressTest test(options);
+	return test.Run() ? 0 : 1;
+}
\ No newline at end of file
@@ -1,73 +1,139 @@
-#pragma once
-
-#include <unordered_map>
-#include <typeindex>
-#include <type_traits>
-#include <memory>
-#include "Component.h"
-#include "TEntitySystem.h"
-
-namespace ecs {
-	template <typename TSettings>
-	class TEntityPrototype {
-	private:
-		using Settings = TSettings;
-		using ComponentList = typename Settings::ComponentList;
-
-		std::string m_name;
-		std::unordered_map<std::type_index, std::shared_ptr<Component>> m_components;
-
-	public:
-
-		TEntityPrototype() {}
-
-		TEntityPrototype(const std::string& name) : m_name{ name } {}
-
-		Entity CreateEntity(TEntitySystem<Settings>& entitySystem) {
-			Entity e = entitySystem.CreateEntity();
-			ComponentList::ForTypes([this, &e, &entitySystem](auto t) {
-				if (Contains<TYPE_OF(t)>()) {
-					entitySystem.AddComponent(e, Get<TYPE_OF(t)>());
-				}
-			});
-			return e;
-		}
-
-		const std::string& GetName() const {
-			return m_name;
-		}
-
-		template <typename CType>
-		void Add(CType obj) {
-			static_assert(Settings::template IsComponent<CType>(), "");
-
-			m_components[std::type_index(typeid(CType))] = std::shared_ptr<CType>(new CType(obj));
-		}
-
-		template <typename CType>
-		void Remove() {
-			static_assert(Settings::template IsComponent<CType>(), "");
-
-			m_components.erase(std::type_index(typeid(CType)));
-		}
-
-		template <typename CType>
-		CType Get() const {
-			static_assert(Settings::template IsComponent<CType>(), "");
-
-			auto componentIter = m_components.find(std::type_index(typeid(CType)));
-			if (componentIter != m_components.end()) {
-				return *(static_cast<CType*>(componentIter->second.get()));
-			}
-			return CType();
-		}
-
-		template <typename CType>
-		bool Contains() const {
-			static_assert(Settings::template IsComponent<CType>(), "");
-
-			auto componentIter = m_components.find(std::type_index(typeid(CType)));
-			return componentIter != m_components.end();
-		}
-	};
+#pragma once
+
+#include <unordered_map>
+#include <typeindex>
+#include <type_traits>
+#include <memory>
+#include <utility>
+#include "Component.h"
+#include "TEntitySystem.h"
+#include "MemoryResource.h"
+
+namespace ecs {
+	template <typename TSettings>
+	class TEntityPrototype {
+	private:
+		using Settings = TSettings;
+		using ComponentList = typename Settings::ComponentList;
+
+		template <typename T>
+		using Allocator = typename Settings::template Allocator<T>;
+
+		using ComponentTable = std::unordered_map<
+			std::type_index,
+			std::shared_ptr<Component>,
+			std::hash<std::type_index>,
+			std::equal_to<std::type_index>,
+			Allocator<std::pair<const std::type_index, std::shared_ptr<Component>>>>;
+
+		using SharedTable = std::unordered_map<
+			std::type_index,
+			std::shared_ptr<const void>,
+			std::hash<std::type_index>,
+			std::equal_to<std::type_index>,
+			Allocator<std::pair<const std::type_index, std::shared_ptr<const void>>>>;
+
+		std::string m_name;
+		MemoryResource* m_resource;
+		ComponentTable m_components;
+		SharedTable m_shared;
+
+	public:
+
+		TEntityPrototype() : TEntityPrototype(std::string()) {}
+
+		TEntityPrototype(const std::string& name, MemoryResource* resource = nullptr) :
+			m_name{ name },
+			m_resource{ resource },
+			m_components{ MakeAllocator<typename ComponentTable::allocator_type>(resource) },
+			m_shared{ MakeAllocator<typename SharedTable::allocator_type>(resource) } {}
+
+		typename Settings::Entity CreateEntity(TEntitySystem<Settings>& entitySystem) {
+			typename Settings::Entity e = entitySystem.CreateEntity();
+			ComponentList::ForTypes([this, &e, &entitySystem](auto t) {
+				if (const TYPE_OF(t)* component = this->template Find<TYPE_OF(t)>()) {
+					entitySystem.AddComponent(e, *component);
+				}
+			});
+			Settings::SharedList::ForTypes([this, &e, &entitySystem](auto t) {
+				if (const TYPE_OF(t)* value = this->template FindShared<TYPE_OF(t)>()) {
+					entitySystem.SetShared(e, *value);
+				}
+			});
+			return e;
+		}
+
+		const std::string& GetName() const {
+			return m_name;
+		}
+
+		template <typename CType>
+		void Add(CType obj) {
+			static_assert(Settings::template IsComponent<CType>(), "");
+
+			m_components[std::type_index(typeid(CType))] = std::allocate_shared<CType>(MakeAllocator<Allocator<CType>>(m_resource), std::move(obj));
+		}
+
+		// Takes every component and shared value of `base` that this
+		// prototype lacks. Stored components are never modified in place,
+		// so they are shared with the base rather than copied.
+		void Inherit(const TEntityPrototype& base) {
+			for (const auto& component : base.m_components) {
+				m_components.insert(component);
+			}
+			for (const auto& shared : base.m_shared) {
+				m_shared.insert(shared);
+			}
+		}
+
+		template <typename CType>
+		void Remove() {
+			static_assert(Settings::template IsComponent<CType>(), "");
+
+			m_components.erase(std::type_index(typeid(CType)));
+		}
+
+		// Stored component, or a default constructed one if there is none
+		template <typename CType>
+		const CType& Get() const {
+			static const CType defaultComponent{};
+			const CType* component = Find<CType>();
+			return component ? *component : defaultComponent;
+		}
+
+		template <typename CType>
+		const CType* Find() const {
+			static_assert(Settings::template IsComponent<CType>(), "");
+
+			auto componentIter = m_components.find(std::type_index(typeid(CType)));
+			if (componentIter != m_components.end()) {
+				return static_cast<const CType*>(componentIter->second.get());
+			}
+			return nullptr;
+		}
+
+		// Shared component given to every entity created from the prototype
+		template <typename T>
+		void SetShared(T value) {
+			static_assert(Settings::template IsShared<T>(), "");
+
+			m_shared[std::type_index(typeid(T))] = std::allocate_shared<T>(MakeAllocator<Allocator<T>>(m_resource), std::move(value));
+		}
+
+		template <typename T>
+		const T* FindShared() const {
+			static_assert(Settings::template IsShared<T>(), "");
+
+			auto sharedIter = m_shared.find(std::type_index(typeid(T)));
+			return sharedIter != m_shared.end() ? static_cast<const T*>(sharedIter->second.get()) : nullptr;
+		}
+
+		template <typename CType>
+		bool Contains() const {
+			static_assert(Settings::template IsComponent<CType>(), "");
+
+			auto componentIter = m_components.find(std::type_index(typeid(CType)));
+			return componentIter != m_components.end();
+		}
+	};
 }
\ No newline at end of file
@@ -1,371 +1,1724 @@
-#pragma once
-
-#include <typeindex>
-#include <typeinfo>
-#include <memory>
-#include <vector>
-#include <algorithm>
-#include <unordered_map>
-#include "Entity.h"
-#include "Component.h"
-#include "Reflection.h"
-
-namespace ecs {
-	using EntityIndex = std::size_t;
-	using ComponentIndex = std::size_t;
-
-	template <typename TSettings>
-	struct TEntityData {
-		using Settings = TSettings;
-		using Bitset = typename Settings::Bitset;
-
-		TEntityData() {}
-
-		bool alive;
-		Entity id;
-		Bitset signature;
-	};
-
-	template <typename TSettings>
-	class TEntitySystem {
-	public:
-		using Settings = TSettings;
-	private:
-		using ThisType = TEntitySystem<Settings>;
-		using EntityData = TEntityData<Settings>;
-
-		using ComponentList = typename Settings::ComponentList;
-		using ComponentPoolTuple = typename ComponentList::template WrapTypes<ComponentPool>::ListTuple;
-		using SignatureBitsetStorage = typename Settings::SignatureBitsetStorage;
-
-		using EntityIndexTable = std::unordered_map<Entity, EntityIndex>;
-		using ComponentIndexTable = std::unordered_map<Entity, ComponentIndex>;
-		using ComponentIndexDatabase = Refl::Repeat<ComponentList::Size, ComponentIndexTable>;
-
-		SignatureBitsetStorage m_signatureBitsets;
-
-		ComponentIndexDatabase m_componentIndexDatabase;
-		ComponentPoolTuple m_componentPools;
-
-		EntityIndexTable m_entityIndexTable;
-		std::vector<EntityData> m_entities;
-
-		std::size_t m_size{ 0 }, m_nextSize{ 0 };
-
-		void growEntityCapacity(std::size_t newCapacity) {
-			std::size_t capacity = m_entities.capacity();
-			assert(newCapacity > capacity);
-
-			m_entities.resize(newCapacity);
-
-			for (std::size_t i = capacity; i < newCapacity; ++i) {
-				EntityData& entity(m_entities[i]);
-				entity.alive = false;
-				entity.id = Entity();
-				entity.signature.reset();
-			}
-		}
-
-		void growIfNeeded() {
-			if (m_entities.capacity() > m_nextSize) return;
-			growEntityCapacity((m_entities.capacity() + 10) * 2);
-		}
-
-		EntityData& getEntityData(Entity e) noexcept {
-			return getEntityData(getEntityIndex(e));
-		}
-
-		const EntityData& getEntityData(Entity e) const noexcept {
-			return getEntityData(getEntityIndex(e));
-		}
-
-		EntityData& getEntityData(EntityIndex index) noexcept {
-			assert(m_nextSize > index);
-			return m_entities[index];
-		}
-
-		const EntityData& getEntityData(EntityIndex index) const noexcept {
-			assert(m_nextSize > index);
-			return m_entities[index];
-		}
-
-		void deleteEntity(EntityIndex index) noexcept {
-			EntityData& entity = getEntityData(index);
-			RemoveAllComponents(entity.id);
-			m_entityIndexTable.erase(entity.id);
-			entity.id = Entity();
-			entity.alive = false;
-		}
-
-	public:
-
-		TEntitySystem() { growEntityCapacity(100); }
-
-		Entity CreateEntity() {
-			static std::size_t idCounter = 1;
-
-			growIfNeeded();
-			EntityIndex freeIndex(m_nextSize++);
-			assert(!IsAlive(freeIndex));
-
-			EntityData& entity(m_entities[freeIndex]);
-			entity.alive = true;
-			entity.id = Entity(idCounter++);
-			entity.signature.reset();
-			m_entityIndexTable[entity.id] = freeIndex;
-
-			assert(IsHandleValid(entity.id));
-			return entity.id;
-		}
-
-		EntityIndex& getEntityIndex(Entity e) noexcept {
-			assert(IsHandleValid(e));
-			return m_entityIndexTable[e];
-		}
-
-		const EntityIndex& getEntityIndex(Entity e) const noexcept {
-			assert(IsHandleValid(e));
-			return m_entityIndexTable.at(e);
-		}
-
-		bool IsHandleValid(Entity e) const noexcept {
-			return m_entityIndexTable.find(e) != m_entityIndexTable.end();
-		}
-
-		bool IsAlive(EntityIndex index) const noexcept {
-			return getEntityData(index).alive;
-		}
-
-		bool IsAlive(Entity e) const noexcept {
-			return IsAlive(getEntityIndex(e));
-		}
-
-		void Kill(EntityIndex index) noexcept {
-			getEntityData(index).alive = false;
-		}
-
-		void Kill(Entity e) noexcept {
-			Kill(getEntityIndex(e));
-		}
-
-		template <typename TagType>
-		bool HasTag(EntityIndex index) const noexcept {
-			static_assert(Settings::template IsTag<TagType>(), "");
-			return getEntityData(index).signature[Settings::template TagBit<TagType>()];
-		}
-
-		template <typename TagType>
-		bool HasTag(Entity e) const noexcept {
-			return HasTag<TagType>(getEntityIndex(e));
-		}
-
-		template <typename TagType>
-		void AddTag(EntityIndex index) noexcept {
-			static_assert(Settings::template IsTag<TagType>(), "");
-			getEntityData(index).signature[Settings::template TagBit<TagType>()] = true;
-		}
-
-		template <typename TagType>
-		void AddTag(Entity e) noexcept {
-			AddTag<TagType>(getEntityIndex(e));
-		}
-
-		template <typename TagType>
-		void RemoveTag(EntityIndex index) noexcept {
-			static_assert(Settings::template IsTag<TagType>(), "");
-			getEntityData(index).signature[Settings::template TagBit<TagType>()] = false;
-		}
-
-		template <typename TagType>
-		void RemoveTag(Entity e) noexcept {
-			RemoveTag<TagType>(getEntityIndex(e));
-		}
-
-		template <typename ComponentType>
-		bool HasComponent(EntityIndex index) const noexcept {
-			static_assert(Settings::template IsComponent<ComponentType>(), "");
-
-			return getEntityData(index).signature[Settings::template ComponentBit<ComponentType>()];
-		}
-
-		template <typename ComponentType>
-		bool HasComponent(Entity e) const noexcept {
-			return HasComponent<ComponentType>(getEntityIndex(e));
-		}
-
-		template <typename ComponentType>
-		void AddComponent(Entity e, const ComponentType& component) noexcept {
-			static_assert(Settings::template IsComponent<ComponentType>(), "");
-
-			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
-			ComponentPool<ComponentType>& pool = getComponentPool<ComponentType>();
-
-			table[e] = pool.create(component);
-			getEntityData(e).signature[Settings::template ComponentBit<ComponentType>()] = true;
-		}
-
-		template <typename ComponentType>
-		ComponentType& GetComponent(Entity e) noexcept {
-			static_assert(Settings::template IsComponent<ComponentType>(), "");
-			assert(HasComponent<ComponentType>(e));
-
-			ComponentPool<ComponentType>& pool = getComponentPool<ComponentType>();
-
-			ComponentIndex index;
-			getComponentIndex<ComponentType>(e, index);
-			return pool[index];
-		}
-
-		void RemoveAllComponents(Entity e) noexcept {
-			ComponentList::ForTypes([this, &e](auto t) {
-				RemoveComponent<TYPE_OF(t)>(e);
-			});
-		}
-
-		template <typename ComponentType>
-		bool RemoveComponent(Entity e) noexcept {
-			static_assert(Settings::template IsComponent<ComponentType>(), "");
-
-			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
-			ComponentPool<ComponentType>& pool = getComponentPool<ComponentType>();
-
-			ComponentIndex index;
-			if (getComponentIndex<ComponentType>(e, index)) {
-				pool.deallocate(index);
-				table.erase(e);
-				getEntityData(e).signature[Settings::template ComponentBit<ComponentType>()] = false;
-				return true;
-			}
-			return false;
-		}
-
-		void Clear() noexcept {
-			for (std::size_t i = 0; i < m_entities.capacity(); ++i) {
-				EntityData& entity(m_entities[i]);
-				if (entity.alive) {
-					RemoveAllComponents(entity.id);
-					entity.alive = false;
-					entity.id = Entity();
-				}
-			}
-			m_entityIndexTable.clear();
-			m_size = m_nextSize = 0;
-		}
-
-		void Refresh() noexcept {
-			if (m_nextSize == 0) {
-				m_size = 0;
-				return;
-			}
-
-			EntityIndex deadIdx{ 0 }, aliveIdx{ m_nextSize - 1 };
-
-			while (true) {
-				while (IsAlive(deadIdx)) {
-					if (++deadIdx > aliveIdx) {
-						m_size = m_nextSize = deadIdx;
-						return;
-					}
-				}
-
-				while (!IsAlive(aliveIdx)) {
-					deleteEntity(aliveIdx);
-					if (--aliveIdx <= deadIdx) {
-						m_size = m_nextSize = deadIdx;
-						return;
-					}
-				}
-
-				assert(!IsAlive(deadIdx));
-				assert(IsAlive(aliveIdx));
-
-				deleteEntity(deadIdx);
-
-				EntityData& dead = getEntityData(deadIdx);
-				EntityData& alive = getEntityData(aliveIdx);
-
-				m_entityIndexTable[alive.id] = deadIdx;
-				std::swap(dead, alive);
-
-				++deadIdx; --aliveIdx;
-			}
-		}
-
-		template <typename TSignature>
-		bool MatchesSignature(EntityIndex index) const noexcept {
-			static_assert(Settings::template IsSignature<TSignature>(), "");
-
-			const auto& entityBitset(getEntityData(index).signature);
-			const auto& signatureBitset(m_signatureBitsets.template GetSignatureBitset<TSignature>());
-
-			return (entityBitset & signatureBitset) == signatureBitset;
-		}
-
-		template <typename TSignature>
-		bool MatchesSignature(Entity e) const noexcept {
-			return MatchesSignature<TSignature>(getEntityIndex(e));
-		}
-
-		template <typename TFunc>
-		void ForEntities(TFunc&& func) {
-			for (EntityIndex i = 0; i < m_size; ++i) {
-				func(i);
-			}
-		}
-
-		template <typename TSignature, typename TFunc>
-		void ForEntitiesMatching(TFunc&& func) {
-			static_assert(Settings::template IsSignature<TSignature>(), "");
-
-			for (EntityIndex i = 0; i < m_size; ++i) {
-				if (MatchesSignature<TSignature>(i)) {
-					expandSignatureCall<TSignature>(i, func);
-				}
-			}
-		}
-
-	private:
-
-		template <typename TSignature, typename TFunc>
-		void expandSignatureCall(EntityIndex index, TFunc&& func) {
-			static_assert(Settings::template IsSignature<TSignature>(), "");
-
-			using RequiredComponents = typename Settings::SignatureBitset::template SignatureComponents<TSignature>;
-			using Helper = typename RequiredComponents::template Rename<ExpandCallHelper>;
-
-			Helper::call(*this, index, func);
-		}
-
-		template <typename... Ts>
-		struct ExpandCallHelper {
-			template <typename TFunc>
-			static void call(ThisType& entitySystem, EntityIndex index, TFunc&& func) {
-				Entity entity = entitySystem.getEntityData(index).id;
-				func(index, entitySystem.GetComponent<Ts>(entity)...);
-			}
-		};
-
-		template <typename ComponentType>
-		bool getComponentIndex(Entity e, ComponentIndex& index) {
-			static_assert(Settings::template IsComponent<ComponentType>(), "");
-
-			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
-			ComponentIndexTable::iterator indexResult = table.find(e);
-			if (indexResult != table.end()) {
-				index = indexResult->second;
-				return true;
-			}
-			return false;
-		}
-
-		template <typename ComponentType>
-		ComponentPool<ComponentType>& getComponentPool() {
-			return std::get<ComponentList::template IndexOf<ComponentType>()>(m_componentPools);
-		}
-
-		template<typename ComponentType>
-		ComponentIndexTable& getComponentIndexTable() {
-			return std::get<ComponentList::template IndexOf<ComponentType>()>(m_componentIndexDatabase);
-		}
-	};
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <unordered_map>
+#include "Entity.h"
+#include "Component.h"
+#include "Reflection.h"
+#include "Span.h"
+#include "TProfiler.h"
+#include "TTagColumns.h"
+#include "TEventQueue.h"
+#include "TSharedStore.h"
+#include "FrameArena.h"
+#include "MemoryStats.h"
+#include "MemoryResource.h"
+
+namespace ecs {
+	using EntityIndex = std::size_t;
+	using ComponentIndex = std::size_t;
+
+	template <typename TSettings>
+	struct TEntityData {
+		using Settings = TSettings;
+		using Bitset = typename Settings::Bitset;
+		using Entity = typename Settings::Entity;
+
+		TEntityData() {}
+
+		bool alive;
+		// Handles into the shared component stores, 0 when absent
+		std::array<std::uint32_t, Settings::SharedCount> shared;
+		Entity id;
+		Bitset signature;
+	};
+
+	enum class ComponentSortMode {
+		// Comparison sort of every component
+		Full,
+		// Insertion sort starting from the current storage order; close to
+		// linear when the storage is already mostly sorted
+		Insertion
+	};
+
+	// Entry of the breadth-first hierarchy order. Parents always precede
+	// their children, so a single forward pass can propagate data down.
+	template <typename TEntity>
+	struct THierarchyNode {
+		static constexpr std::size_t NoParent = std::size_t(-1);
+
+		TEntity entity;
+		EntityIndex index;
+		std::size_t parent;
+		std::size_t depth;
+	};
+
+	using HierarchyNode = THierarchyNode<Entity>;
+
+	template <typename TSettings>
+	class TEntitySystem {
+	public:
+		using Settings = TSettings;
+		using Entity = typename Settings::Entity;
+		using HierarchyNode = THierarchyNode<Entity>;
+		using Profiler = TProfiler<Settings>;
+
+		template <typename TEvent>
+		using EventQueue = TEventQueue<TEvent, typename Settings::template Allocator<TEvent>>;
+
+		template <typename T>
+		using SharedStore = TSharedStore<T, typename Settings::template Allocator<T>>;
+
+		template <typename T>
+		using FrameAllocator = TResourceAllocator<T>;
+
+		template <typename T>
+		using FrameVector = std::vector<T, FrameAllocator<T>>;
+	private:
+		using ThisType = TEntitySystem<Settings>;
+		using EntityData = TEntityData<Settings>;
+
+		template <typename T>
+		using Allocator = typename Settings::template Allocator<T>;
+
+		template <typename TKey, typename TValue>
+		using HashTable = std::unordered_map<TKey, TValue, std::hash<TKey>, std::equal_to<TKey>, Allocator<std::pair<const TKey, TValue>>>;
+
+		template <typename ComponentType>
+		using Pool = ComponentPool<ComponentType, Allocator<ComponentType>>;
+
+		using ComponentList = typename Settings::ComponentList;
+		using ComponentPoolTuple = typename ComponentList::template WrapTypes<Pool>::ListTuple;
+		using SignatureBitsetStorage = typename Settings::SignatureBitsetStorage;
+		using SingletonTuple = typename Settings::SingletonList::ListTuple;
+		using EventQueueTuple = typename Settings::EventList::template WrapTypes<EventQueue>::ListTuple;
+		using SharedStoreTuple = typename Settings::SharedList::template WrapTypes<SharedStore>::ListTuple;
+
+		using EntityIndexTable = HashTable<Entity, EntityIndex>;
+		using ComponentIndexTable = HashTable<Entity, ComponentIndex>;
+		using ComponentIndexDatabase = Refl::Repeat<ComponentList::Size, ComponentIndexTable>;
+
+		// Owning entity of every pool slot, Entity() for free slots
+		using ComponentOwnerTable = std::vector<Entity, Allocator<Entity>>;
+		using ComponentOwnerDatabase = Refl::Repeat<ComponentList::Size, ComponentOwnerTable>;
+
+		MemoryResource* m_resource;
+
+		// Shared by every allocation made from worker threads
+		LockedResource m_lockedResource;
+
+		SignatureBitsetStorage m_signatureBitsets;
+
+		ComponentIndexDatabase m_componentIndexDatabase;
+		ComponentOwnerDatabase m_componentOwnerDatabase;
+		ComponentPoolTuple m_componentPools;
+
+		// Progress of an incremental Defragment() pass per component type
+		struct DefragCursor {
+			EntityIndex entity{ 0 };
+			ComponentIndex slot{ 0 };
+		};
+		std::array<DefragCursor, ComponentList::Size> m_defragCursors;
+
+		// Owning groups: members occupy slots [0, size) of every grouped pool
+		template <typename TGroup>
+		using GroupComponents = typename Settings::SignatureBitset::template SignatureComponents<TGroup>;
+
+		template <typename ComponentType>
+		struct OwnedBy {
+			template <typename TGroup>
+			using Filter = std::integral_constant<bool, GroupComponents<TGroup>::template Contains<ComponentType>()>;
+		};
+
+		template <typename ComponentType>
+		using OwningGroups = typename Settings::GroupList::template Filter<OwnedBy<ComponentType>::template Filter>;
+
+		std::array<std::size_t, Settings::GroupCount> m_groupSizes{};
+
+		EntityIndexTable m_entityIndexTable;
+		std::vector<EntityData, Allocator<EntityData>> m_entities;
+		TTagColumns<Settings::TagCount, Allocator<std::uint64_t>> m_tagColumns;
+
+		std::size_t m_size{ 0 }, m_nextSize{ 0 };
+
+		// Handle ids are drawn from a per-world counter. Handles reserved by
+		// worker threads wait here until the next sync point creates them.
+		std::atomic<std::size_t> m_nextId{ 1 };
+		TEventQueue<Entity, Allocator<Entity>> m_reservedEntities;
+
+		// Slot reuse for handles with generation bits. Reservation pops free
+		// slots from worker threads, so the slot lists are locked.
+		using HandleId = typename Entity::Id;
+		using HandleSlots = std::integral_constant<bool, (Entity::GenerationBits > 0)>;
+		std::mutex m_handleMutex;
+		std::vector<HandleId, Allocator<HandleId>> m_handleGenerations;
+		std::vector<HandleId, Allocator<HandleId>> m_freeHandleSlots;
+
+		// Parent/child links, stored only for entities that have either
+		struct Relationship {
+			Entity parent;
+			Entity firstChild;
+			Entity prevSibling;
+			Entity nextSibling;
+			std::size_t childCount{ 0 };
+		};
+
+		HashTable<Entity, Relationship> m_relationships;
+		std::vector<HierarchyNode, Allocator<HierarchyNode>> m_hierarchyOrder;
+		bool m_hierarchyDirty{ false };
+
+		SingletonTuple m_singletons;
+		EventQueueTuple m_eventQueues;
+
+		SharedStoreTuple m_sharedStores;
+
+		FrameArena m_frameArena;
+
+		Profiler m_profiler;
+
+		void growEntityCapacity(std::size_t newCapacity) {
+			std::size_t capacity = m_entities.size();
+			assert(newCapacity > capacity);
+
+			m_entities.resize(newCapacity);
+			m_tagColumns.Reserve(newCapacity);
+
+			for (std::size_t i = capacity; i < newCapacity; ++i) {
+				EntityData& entity(m_entities[i]);
+				entity.alive = false;
+				entity.id = Entity();
+				entity.signature.reset();
+			}
+		}
+
+		void growIfNeeded() {
+			if (m_entities.size() > m_nextSize) return;
+			growEntityCapacity((m_entities.size() + 10) * 2);
+		}
+
+		EntityData& getEntityData(Entity e) noexcept {
+			return getEntityData(getEntityIndex(e));
+		}
+
+		const EntityData& getEntityData(Entity e) const noexcept {
+			return getEntityData(getEntityIndex(e));
+		}
+
+		EntityData& getEntityData(EntityIndex index) noexcept {
+			assert(m_nextSize > index);
+			return m_entities[index];
+		}
+
+		const EntityData& getEntityData(EntityIndex index) const noexcept {
+			assert(m_nextSize > index);
+			return m_entities[index];
+		}
+
+		void deleteEntity(EntityIndex index) noexcept {
+			EntityData& entity = getEntityData(index);
+			RemoveAllComponents(entity.id);
+			releaseShared(entity);
+			unlinkRelationships(entity.id);
+			m_entityIndexTable.erase(entity.id);
+			releaseHandle(entity.id);
+			entity.id = Entity();
+			entity.alive = false;
+			m_profiler.OnDestroy();
+		}
+
+	public:
+
+		// Largest handle index an Entity can carry; a world never holds more
+		// than MaxHandleIndex entities at once
+		static constexpr std::uint64_t MaxHandleIndex = std::min<std::uint64_t>(Entity::IndexMask, std::numeric_limits<HandleId>::max());
+
+		TEntitySystem() : TEntitySystem(nullptr) {}
+
+		// Every container of the system allocates from `resource` when the
+		// Settings allocator policy accepts a MemoryResource*
+		explicit TEntitySystem(MemoryResource* resource) :
+			m_resource{ resource },
+			m_lockedResource{ resource ? resource : GetDefaultResource() },
+			m_componentIndexDatabase{ makeRepeated<ComponentIndexDatabase, ComponentIndexTable>(resource, std::make_index_sequence<ComponentList::Size>()) },
+			m_componentOwnerDatabase{ makeRepeated<ComponentOwnerDatabase, ComponentOwnerTable>(resource, std::make_index_sequence<ComponentList::Size>()) },
+			m_componentPools{ ComponentList::template Rename<PoolTupleBuilder>::Build(resource) },
+			m_entityIndexTable{ MakeAllocator<typename EntityIndexTable::allocator_type>(resource) },
+			m_entities{ MakeAllocator<Allocator<EntityData>>(resource) },
+			m_tagColumns{ MakeAllocator<Allocator<std::uint64_t>>(resource) },
+			m_reservedEntities{ MakeAllocator<Allocator<Entity>>(resource), 64, &m_lockedResource },
+			m_handleGenerations{ MakeAllocator<Allocator<HandleId>>(resource) },
+			m_freeHandleSlots{ MakeAllocator<Allocator<HandleId>>(resource) },
+			m_relationships{ MakeAllocator<typename HashTable<Entity, Relationship>::allocator_type>(resource) },
+			m_hierarchyOrder{ MakeAllocator<Allocator<HierarchyNode>>(resource) },
+			m_eventQueues{ Settings::EventList::template Rename<EventQueueTupleBuilder>::Build(resource, &m_lockedResource) },
+			m_sharedStores{ Settings::SharedList::template Rename<SharedStoreTupleBuilder>::Build(resource) },
+			m_frameArena{ &m_lockedResource } {
+
+			assert(resource == nullptr || (std::is_constructible<Allocator<EntityData>, MemoryResource*>::value));
+			ComponentList::ForTypes([](auto t) {
+				static_assert(OwningGroups<TYPE_OF(t)>::Size <= 1, "a component can belong to one group at most");
+			});
+			Settings::GroupList::ForTypes([](auto t) {
+				using Group = TYPE_OF(t);
+				static_assert(Settings::template IsSignature<Group>(), "");
+				static_assert(GroupComponents<Group>::Size == Group::Size, "groups can not contain tags");
+			});
+			growEntityCapacity(100);
+		}
+
+		MemoryResource* GetResource() const noexcept {
+			return m_resource;
+		}
+
+		// Singletons. Stored inline, so access is a direct member reference;
+		// they are not affected by Clear().
+
+		template <typename T>
+		T& GetSingleton() noexcept {
+			static_assert(Settings::template IsSingleton<T>(), "");
+			return std::get<Settings::template SingletonId<T>()>(m_singletons);
+		}
+
+		template <typename T>
+		const T& GetSingleton() const noexcept {
+			static_assert(Settings::template IsSingleton<T>(), "");
+			return std::get<Settings::template SingletonId<T>()>(m_singletons);
+		}
+
+		template <typename T>
+		void SetSingleton(T value) {
+			GetSingleton<T>() = std::move(value);
+		}
+
+		// Events. EmitEvent() is safe to call from several threads at once;
+		// ReadEvents() returns the events emitted before the last Refresh().
+		// Clear() drops every queued event.
+
+		template <typename TEvent>
+		void EmitEvent(TEvent event) {
+			GetEventQueue<TEvent>().Emit(std::move(event));
+		}
+
+		template <typename TEvent>
+		TSpan<const TEvent> ReadEvents() const noexcept {
+			return GetEventQueue<TEvent>().Read();
+		}
+
+		template <typename TEvent>
+		EventQueue<TEvent>& GetEventQueue() noexcept {
+			static_assert(Settings::template IsEvent<TEvent>(), "");
+			return std::get<Settings::template EventId<TEvent>()>(m_eventQueues);
+		}
+
+		template <typename TEvent>
+		const EventQueue<TEvent>& GetEventQueue() const noexcept {
+			static_assert(Settings::template IsEvent<TEvent>(), "");
+			return std::get<Settings::template EventId<TEvent>()>(m_eventQueues);
+		}
+
+		// Shared components. An entity holds at most one value of each shared
+		// type; SetShared() stores the value once per distinct value and
+		// GetShared() returns the stored copy, which must not be modified.
+
+		template <typename T>
+		void SetShared(Entity e, const T& value) {
+			static_assert(Settings::template IsShared<T>(), "");
+			std::uint32_t& handle = getEntityData(e).shared[Settings::template SharedId<T>()];
+			std::uint32_t previous = handle;
+			handle = GetSharedStore<T>().Acquire(value);
+			if (previous != 0) {
+				GetSharedStore<T>().Release(previous);
+			}
+		}
+
+		template <typename T>
+		bool HasShared(Entity e) const noexcept {
+			static_assert(Settings::template IsShared<T>(), "");
+			return getEntityData(e).shared[Settings::template SharedId<T>()] != 0;
+		}
+
+		template <typename T>
+		const T& GetShared(Entity e) const noexcept {
+			static_assert(Settings::template IsShared<T>(), "");
+			assert(HasShared<T>(e));
+			return GetSharedStore<T>().Get(getEntityData(e).shared[Settings::template SharedId<T>()]);
+		}
+
+		template <typename T>
+		bool RemoveShared(Entity e) {
+			static_assert(Settings::template IsShared<T>(), "");
+			std::uint32_t& handle = getEntityData(e).shared[Settings::template SharedId<T>()];
+			if (handle == 0) return false;
+			GetSharedStore<T>().Release(handle);
+			handle = 0;
+			return true;
+		}
+
+		// Calls func(const T&, TSpan<const EntityIndex>) once per distinct
+		// value held by a live refreshed entity, with those entities' indices
+		// in ascending order, e.g. to submit one instanced draw per mesh. The
+		// spans live in frame scratch, so func may call ForSharedGroups again.
+		template <typename T, typename TFunc>
+		void ForSharedGroups(TFunc&& func) {
+			static_assert(Settings::template IsShared<T>(), "");
+			const SharedStore<T>& store = GetSharedStore<T>();
+			const std::size_t id = Settings::template SharedId<T>();
+
+			// Counting sort of the entity indices by handle; killed entities
+			// count towards handle 0, which is never reported
+			auto handleOf = [this, id](EntityIndex i) {
+				return m_entities[i].alive ? m_entities[i].shared[id] : 0;
+			};
+			FrameVector<std::size_t> offsets(store.HandleLimit() + 1, 0, GetFrameAllocator<std::size_t>());
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				++offsets[handleOf(i) + 1];
+			}
+			for (std::size_t h = 1; h < offsets.size(); ++h) {
+				offsets[h] += offsets[h - 1];
+			}
+			FrameVector<EntityIndex> indices(m_size, EntityIndex(), GetFrameAllocator<EntityIndex>());
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				indices[offsets[handleOf(i)]++] = i;
+			}
+
+			// Offsets now hold the end of each group
+			for (std::size_t h = 1; h < store.HandleLimit(); ++h) {
+				const std::size_t first = offsets[h - 1], last = offsets[h];
+				if (first != last) {
+					func(store.Get(std::uint32_t(h)), TSpan<const EntityIndex>(indices.data() + first, last - first));
+				}
+			}
+		}
+
+		template <typename T>
+		SharedStore<T>& GetSharedStore() noexcept {
+			static_assert(Settings::template IsShared<T>(), "");
+			return std::get<Settings::template SharedId<T>()>(m_sharedStores);
+		}
+
+		template <typename T>
+		const SharedStore<T>& GetSharedStore() const noexcept {
+			static_assert(Settings::template IsShared<T>(), "");
+			return std::get<Settings::template SharedId<T>()>(m_sharedStores);
+		}
+
+		// Frame scratch memory. Each thread gets its own arena, and all of
+		// them are rewound by the next Refresh(), so anything allocated here
+		// must be gone by then. Deallocation is a no-op.
+
+		MemoryResource* GetFrameResource() {
+			return m_frameArena.Local();
+		}
+
+		template <typename T>
+		FrameAllocator<T> GetFrameAllocator() {
+			return FrameAllocator<T>(m_frameArena.Local());
+		}
+
+		template <typename T>
+		FrameVector<T> MakeFrameVector() {
+			return FrameVector<T>(GetFrameAllocator<T>());
+		}
+
+		const FrameArena& GetFrameArena() const noexcept {
+			return m_frameArena;
+		}
+
+		Entity CreateEntity() {
+			return createEntity(acquireHandle(HandleSlots()));
+		}
+
+		// Thread-safe. Returns a handle that may be stored right away (in
+		// components, events, ...) but only refers to a live entity once
+		// MaterializeReserved() or Refresh() has run on the owning thread.
+		// Throws std::length_error once the handle index space is used up.
+		Entity ReserveEntity() {
+			Entity e(acquireHandle(HandleSlots()));
+			m_reservedEntities.Emit(e);
+			return e;
+		}
+
+		// Thread-safe. Reserves `count` handles and appends them to `out`:
+		// free slots first, then the rest with a single atomic increment.
+		template <typename TOutput>
+		void ReserveEntities(std::size_t count, TOutput& out) {
+			auto reserve = [this, &out](Entity e) {
+				m_reservedEntities.Emit(e);
+				out.push_back(e);
+			};
+			count = acquireFreeSlots(count, reserve, HandleSlots());
+			if (count == 0) return;
+
+			std::size_t first = m_nextId.fetch_add(count, std::memory_order_relaxed);
+			checkHandleSpace(first, count);
+			for (std::size_t i = 0; i < count; ++i) {
+				reserve(Entity(HandleId(first + i)));
+			}
+		}
+
+		// Creates every reserved entity. Called by Refresh(); must not run
+		// concurrently with ReserveEntity().
+		void MaterializeReserved() {
+			m_reservedEntities.Swap();
+			TSpan<const Entity> reserved = m_reservedEntities.Read();
+			if (reserved.empty()) return;
+
+			if (m_nextSize + reserved.size() > m_entities.size()) {
+				growEntityCapacity((m_nextSize + reserved.size()) * 2);
+			}
+			for (Entity e : reserved) {
+				createEntity(e);
+			}
+		}
+
+	private:
+
+		Entity createEntity(Entity id) {
+			growIfNeeded();
+			EntityIndex freeIndex(m_nextSize++);
+			assert(!IsAlive(freeIndex));
+
+			EntityData& entity(m_entities[freeIndex]);
+			entity.alive = true;
+			entity.id = id;
+			entity.signature.reset();
+			entity.shared.fill(0);
+			m_tagColumns.ClearIndex(freeIndex);
+			m_entityIndexTable[entity.id] = freeIndex;
+			m_profiler.OnCreate();
+
+			assert(IsHandleValid(entity.id));
+			return entity.id;
+		}
+
+		// Counter values [first, first + count) must fit the handle index.
+		// Past that, ids would spill into the generation bits and alias live
+		// handles, so this fails in every build type. The counter stays
+		// exhausted; only freed slots can be handed out afterwards.
+		static void checkHandleSpace(std::size_t first, std::size_t count) {
+			if (std::uint64_t(first) > MaxHandleIndex || std::uint64_t(count - 1) > MaxHandleIndex - std::uint64_t(first)) {
+				throw std::length_error("TEntitySystem: entity handle space exhausted");
+			}
+		}
+
+		Entity acquireHandle(std::false_type) {
+			std::size_t counter = m_nextId.fetch_add(1, std::memory_order_relaxed);
+			checkHandleSpace(counter, 1);
+			return Entity(HandleId(counter));
+		}
+
+		Entity acquireHandle(std::true_type) {
+			Entity e;
+			if (acquireFreeSlots(1, [&e](Entity slot) { e = slot; }, std::true_type()) == 0) {
+				return e;
+			}
+			return acquireHandle(std::false_type());
+		}
+
+		// Hands up to `count` free slots to func(Entity); returns how many
+		// handles are still needed
+		template <typename TFunc>
+		std::size_t acquireFreeSlots(std::size_t count, TFunc&&, std::false_type) noexcept {
+			return count;
+		}
+
+		template <typename TFunc>
+		std::size_t acquireFreeSlots(std::size_t count, TFunc&& func, std::true_type) {
+			std::lock_guard<std::mutex> lock(m_handleMutex);
+			for (; count > 0 && !m_freeHandleSlots.empty(); --count) {
+				std::size_t slot = m_freeHandleSlots.back();
+				m_freeHandleSlots.pop_back();
+				func(Entity::Make(slot, m_handleGenerations[slot]));
+			}
+			return count;
+		}
+
+		void releaseHandle(Entity e) noexcept {
+			releaseHandle(e, HandleSlots());
+		}
+
+		void releaseHandle(Entity, std::false_type) noexcept {}
+
+		void releaseHandle(Entity e, std::true_type) noexcept {
+			if (e == Entity()) return;
+
+			std::lock_guard<std::mutex> lock(m_handleMutex);
+			std::size_t slot = e.Index();
+			if (slot >= m_handleGenerations.size()) {
+				m_handleGenerations.resize(slot + 1, HandleId(0));
+			}
+			m_handleGenerations[slot] = HandleId((e.Generation() + 1) & ((std::size_t(1) << Entity::GenerationBits) - 1));
+			m_freeHandleSlots.push_back(HandleId(slot));
+		}
+
+	public:
+
+		EntityIndex& getEntityIndex(Entity e) noexcept {
+			assert(IsHandleValid(e));
+			return m_entityIndexTable[e];
+		}
+
+		const EntityIndex& getEntityIndex(Entity e) const noexcept {
+			assert(IsHandleValid(e));
+			return m_entityIndexTable.at(e);
+		}
+
+		Entity GetEntity(EntityIndex index) const noexcept {
+			return getEntityData(index).id;
+		}
+
+		bool IsHandleValid(Entity e) const noexcept {
+			return m_entityIndexTable.find(e) != m_entityIndexTable.end();
+		}
+
+		bool IsAlive(EntityIndex index) const noexcept {
+			return getEntityData(index).alive;
+		}
+
+		bool IsAlive(Entity e) const noexcept {
+			return IsAlive(getEntityIndex(e));
+		}
+
+		void Kill(EntityIndex index) noexcept {
+			getEntityData(index).alive = false;
+			m_profiler.OnKill();
+		}
+
+		void Kill(Entity e) noexcept {
+			Kill(getEntityIndex(e));
+		}
+
+		template <typename TagType>
+		bool HasTag(EntityIndex index) const noexcept {
+			static_assert(Settings::template IsTag<TagType>(), "");
+			return getEntityData(index).signature[Settings::template TagBit<TagType>()];
+		}
+
+		template <typename TagType>
+		bool HasTag(Entity e) const noexcept {
+			return HasTag<TagType>(getEntityIndex(e));
+		}
+
+		template <typename TagType>
+		void AddTag(EntityIndex index) noexcept {
+			static_assert(Settings::template IsTag<TagType>(), "");
+			getEntityData(index).signature[Settings::template TagBit<TagType>()] = true;
+			m_tagColumns.Set(Settings::template TagId<TagType>(), index, true);
+		}
+
+		template <typename TagType>
+		void AddTag(Entity e) noexcept {
+			AddTag<TagType>(getEntityIndex(e));
+		}
+
+		template <typename TagType>
+		void RemoveTag(EntityIndex index) noexcept {
+			static_assert(Settings::template IsTag<TagType>(), "");
+			getEntityData(index).signature[Settings::template TagBit<TagType>()] = false;
+			m_tagColumns.Set(Settings::template TagId<TagType>(), index, false);
+		}
+
+		template <typename TagType>
+		void RemoveTag(Entity e) noexcept {
+			RemoveTag<TagType>(getEntityIndex(e));
+		}
+
+		// Bulk tag changes over the index range [first, last) or a list of
+		// indices such as a query result. The tag column is written a word
+		// at a time and signatures are updated by index, with no hash lookups.
+
+		template <typename TagType>
+		void AddTags(EntityIndex first, EntityIndex last) noexcept {
+			setTagRange<TagType>(first, last, true);
+		}
+
+		template <typename TagType>
+		void RemoveTags(EntityIndex first, EntityIndex last) noexcept {
+			setTagRange<TagType>(first, last, false);
+		}
+
+		template <typename TagType, typename TIndices>
+		void AddTags(const TIndices& indices) noexcept {
+			for (EntityIndex index : indices) {
+				AddTag<TagType>(index);
+			}
+		}
+
+		template <typename TagType, typename TIndices>
+		void RemoveTags(const TIndices& indices) noexcept {
+			for (EntityIndex index : indices) {
+				RemoveTag<TagType>(index);
+			}
+		}
+
+		// Number of entities having all of TagTypes, counted with word-wise
+		// AND and popcount over the tag columns
+		template <typename... TagTypes>
+		std::size_t CountTagged() const noexcept {
+			return m_tagColumns.Count(tagIds<TagTypes...>(), m_size);
+		}
+
+		// Calls func(EntityIndex) for every entity having all of TagTypes
+		template <typename... TagTypes, typename TFunc>
+		void ForEntitiesTagged(TFunc&& func) {
+			m_tagColumns.ForEach(tagIds<TagTypes...>(), m_size, func);
+		}
+
+		template <typename ComponentType>
+		bool HasComponent(EntityIndex index) const noexcept {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			return getEntityData(index).signature[Settings::template ComponentBit<ComponentType>()];
+		}
+
+		template <typename ComponentType>
+		bool HasComponent(Entity e) const noexcept {
+			return HasComponent<ComponentType>(getEntityIndex(e));
+		}
+
+		// Adding a component the entity already has assigns to the stored one
+		template <typename ComponentType>
+		void AddComponent(Entity e, const ComponentType& component) noexcept {
+			EmplaceComponent<ComponentType>(e, component);
+		}
+
+		template <typename ComponentType, typename = std::enable_if_t<!std::is_lvalue_reference<ComponentType>::value>>
+		void AddComponent(Entity e, ComponentType&& component) noexcept {
+			EmplaceComponent<std::decay_t<ComponentType>>(e, std::move(component));
+		}
+
+		// Constructs the component in its pool slot from `args`
+		template <typename ComponentType, typename... TArgs>
+		ComponentType& EmplaceComponent(Entity e, TArgs&&... args) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+
+			auto existing = table.find(e);
+			if (existing != table.end()) {
+				ComponentType& component = pool[existing->second];
+				component = ComponentType(std::forward<TArgs>(args)...);
+				return component;
+			}
+
+			ComponentIndex index = pool.create(std::forward<TArgs>(args)...);
+			assert(!Settings::template IsDense<ComponentType>() || index + 1 == pool.size());
+			table.emplace(e, index);
+			setComponentOwner<ComponentType>(index, e);
+			getEntityData(e).signature[Settings::template ComponentBit<ComponentType>()] = true;
+			m_profiler.OnAddComponent();
+			joinGroups<ComponentType>(e);
+			return pool[table[e]];
+		}
+
+		// Existing component, or one constructed from `args` if there is none
+		template <typename ComponentType, typename... TArgs>
+		ComponentType& GetOrAdd(Entity e, TArgs&&... args) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			ComponentIndex index;
+			if (getComponentIndex<ComponentType>(e, index)) {
+				return getComponentPool<ComponentType>()[index];
+			}
+			return EmplaceComponent<ComponentType>(e, std::forward<TArgs>(args)...);
+		}
+
+		template <typename ComponentType>
+		ComponentType& GetComponent(Entity e) noexcept {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+			assert(HasComponent<ComponentType>(e));
+
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+
+			ComponentIndex index = 0;
+			const bool found = getComponentIndex<ComponentType>(e, index);
+			assert(found);
+			(void)found;
+			return pool[index];
+		}
+
+		void RemoveAllComponents(Entity e) noexcept {
+			ComponentList::ForTypes([this, &e](auto t) {
+				RemoveComponent<TYPE_OF(t)>(e);
+			});
+		}
+
+		template <typename ComponentType>
+		bool RemoveComponent(Entity e) noexcept {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+
+			ComponentIndex index;
+			if (getComponentIndex<ComponentType>(e, index)) {
+				leaveGroups<ComponentType>(e, index);
+
+				ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+				pool.deallocate(index);
+				table.erase(e);
+				owners[index] = Entity();
+
+				// Dense storage: the last component fills the hole
+				const ComponentIndex last = pool.size();
+				if (Settings::template IsDense<ComponentType>() && last != index) {
+					pool.relocate(int(last), int(index));
+					Entity moved = owners[last];
+					owners[index] = moved;
+					owners[last] = Entity();
+					table[moved] = index;
+				}
+
+				getEntityData(e).signature[Settings::template ComponentBit<ComponentType>()] = false;
+				m_profiler.OnRemoveComponent();
+				return true;
+			}
+			return false;
+		}
+
+		// Calls func(Entity, ComponentType&) for every ComponentType in
+		// storage order, which is sorted order after SortComponents()
+		template <typename ComponentType, typename TFunc>
+		void ForEachComponent(TFunc&& func) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+			const ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+			for (ComponentIndex i = 0; i < owners.size(); ++i) {
+				if (owners[i] != Entity()) {
+					func(owners[i], pool[i]);
+				}
+			}
+		}
+
+		// Calls func(TSpan<const Entity> owners, TSpan<ComponentType>) once
+		// per storage page of a dense component type. Together the spans
+		// cover every component in storage order with no holes.
+		template <typename ComponentType, typename TFunc>
+		void ForComponentSpans(TFunc&& func) {
+			static_assert(Settings::template IsDense<ComponentType>(), "");
+
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+			const ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+			const std::size_t size = pool.size();
+			for (std::size_t first = 0; first < size; first += COMPONENT_POOL_SIZE) {
+				const std::size_t count = std::min(COMPONENT_POOL_SIZE, size - first);
+				func(TSpan<const Entity>(owners.data() + first, count),
+					TSpan<ComponentType>(pool.page_data(first / COMPONENT_POOL_SIZE), count));
+			}
+		}
+
+		// Physically reorders ComponentType storage by `compare`, packing
+		// the components at the front of the pool. With reorderEntities the
+		// refreshed entities owning the component are moved to the front of
+		// the entity array in the same order, so ForEntitiesMatching visits
+		// them sorted as well; entity indices change as they do on Refresh().
+		template <typename ComponentType, typename TCompare>
+		void SortComponents(TCompare&& compare, ComponentSortMode mode = ComponentSortMode::Full, bool reorderEntities = false) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+
+			FrameVector<ComponentIndex> order = MakeFrameVector<ComponentIndex>();
+			order.reserve(pool.size());
+			for (ComponentIndex i = 0; i < owners.size(); ++i) {
+				if (owners[i] != Entity()) {
+					order.push_back(i);
+				}
+			}
+
+			auto less = [&pool, &compare](ComponentIndex a, ComponentIndex b) {
+				return compare(static_cast<const ComponentType&>(pool[a]), static_cast<const ComponentType&>(pool[b]));
+			};
+
+			if (mode == ComponentSortMode::Insertion) {
+				for (std::size_t i = 1; i < order.size(); ++i) {
+					ComponentIndex current = order[i];
+					std::size_t j = i;
+					for (; j > 0 && less(current, order[j - 1]); --j) {
+						order[j] = order[j - 1];
+					}
+					order[j] = current;
+				}
+			}
+			else {
+				std::stable_sort(order.begin(), order.end(), less);
+			}
+
+			pool.compact(order);
+
+			ComponentOwnerTable sorted(pool.capacity(), Entity(), owners.get_allocator());
+			for (ComponentIndex i = 0; i < order.size(); ++i) {
+				Entity owner = owners[order[i]];
+				sorted[i] = owner;
+				table[owner] = i;
+			}
+			owners.swap(sorted);
+
+			OwningGroups<ComponentType>::ForTypes([this](auto t) {
+				this->template rebuildGroup<TYPE_OF(t)>();
+			});
+
+			if (reorderEntities) {
+				reorderEntitiesByComponent<ComponentType>();
+			}
+		}
+
+		// Calls func(Entity, Components&...) for every member of an owning
+		// group: the group counterpart of ForEntitiesMatching, walking the
+		// grouped pools as parallel arrays without any lookup. Members are
+		// visited in storage order and include entities created or killed
+		// since the last Refresh().
+		template <typename TGroup, typename TFunc>
+		void ForGroup(TFunc&& func) {
+			static_assert(Settings::template IsGroup<TGroup>(), "");
+
+			GroupComponents<TGroup>::template Rename<GroupCallHelper>::call(*this, GroupSize<TGroup>(), func);
+		}
+
+		template <typename TGroup>
+		std::size_t GroupSize() const noexcept {
+			static_assert(Settings::template IsGroup<TGroup>(), "");
+			return m_groupSizes[Settings::template GroupId<TGroup>()];
+		}
+
+		// Relocates ComponentType storage into entity iteration order and
+		// packs it at the front of the pool, so ForEntitiesMatching reads the
+		// pool front to back again after heavy churn. At most `budget`
+		// components are placed per call and the next call resumes the pass;
+		// returns true once the pass has reached the last entity. Entity
+		// indices are unaffected, component references are invalidated.
+		template <typename ComponentType>
+		bool Defragment(std::size_t budget = std::numeric_limits<std::size_t>::max()) {
+			return defragment<ComponentType>(budget);
+		}
+
+		// Defragment() of every component type in turn, sharing one budget
+		bool DefragmentAll(std::size_t budget = std::numeric_limits<std::size_t>::max()) {
+			bool done = true;
+			ComponentList::ForTypes([this, &budget, &done](auto t) {
+				done = this->template defragment<TYPE_OF(t)>(budget) && done;
+			});
+			return done;
+		}
+
+		// Not noexcept: pending reservations are created first, which may
+		// allocate, so their slots are freed with everything else
+		void Clear() {
+			MaterializeReserved();
+			for (std::size_t i = 0; i < m_entities.size(); ++i) {
+				EntityData& entity(m_entities[i]);
+				// Killed entities keep their components until Refresh()
+				if (entity.id != Entity()) {
+					RemoveAllComponents(entity.id);
+					releaseHandle(entity.id);
+					entity.shared.fill(0);
+					entity.alive = false;
+					entity.id = Entity();
+				}
+			}
+			Settings::SharedList::ForTypes([this](auto t) {
+				this->template GetSharedStore<TYPE_OF(t)>().Clear();
+			});
+			// Events may carry handles from before the clear
+			Settings::EventList::ForTypes([this](auto t) {
+				this->template GetEventQueue<TYPE_OF(t)>().Clear();
+			});
+			m_entityIndexTable.clear();
+			m_tagColumns.Reset();
+			m_relationships.clear();
+			m_hierarchyOrder.clear();
+			m_hierarchyDirty = false;
+			m_defragCursors.fill(DefragCursor());
+			m_groupSizes.fill(0);
+			m_size = m_nextSize = 0;
+		}
+
+		// May throw std::bad_alloc while creating reserved entities
+		void Refresh() {
+			auto frameScope(m_profiler.ScopeRefresh());
+
+			m_frameArena.Reset();
+			MaterializeReserved();
+
+			Settings::EventList::ForTypes([this](auto t) {
+				this->template GetEventQueue<TYPE_OF(t)>().Swap();
+			});
+
+			if (!m_relationships.empty()) {
+				killDescendantsOfDead();
+				m_hierarchyDirty = true;
+			}
+
+			if (m_nextSize == 0) {
+				m_size = 0;
+				return;
+			}
+
+			EntityIndex deadIdx{ 0 }, aliveIdx{ m_nextSize - 1 };
+
+			while (true) {
+				while (IsAlive(deadIdx)) {
+					if (++deadIdx > aliveIdx) {
+						m_size = m_nextSize = deadIdx;
+						return;
+					}
+				}
+
+				while (!IsAlive(aliveIdx)) {
+					deleteEntity(aliveIdx);
+					if (aliveIdx-- <= deadIdx) {
+						m_size = m_nextSize = deadIdx;
+						return;
+					}
+				}
+
+				assert(!IsAlive(deadIdx));
+				assert(IsAlive(aliveIdx));
+
+				deleteEntity(deadIdx);
+
+				EntityData& dead = getEntityData(deadIdx);
+				EntityData& alive = getEntityData(aliveIdx);
+
+				m_entityIndexTable[alive.id] = deadIdx;
+				std::swap(dead, alive);
+				m_tagColumns.Swap(deadIdx, aliveIdx);
+
+				++deadIdx; --aliveIdx;
+				if (deadIdx > aliveIdx) {
+					m_size = m_nextSize = deadIdx;
+					return;
+				}
+			}
+		}
+
+		// Hierarchy
+
+		// Attaches `child` under `parent`, detaching it from any previous
+		// parent. Killing a parent kills its whole subtree on Refresh().
+		void SetParent(Entity child, Entity parent) {
+			assert(IsHandleValid(child) && IsHandleValid(parent) && child != parent);
+			assert(!IsDescendantOf(parent, child));
+
+			RemoveParent(child);
+
+			Relationship& childLinks = m_relationships[child];
+			Relationship& parentLinks = m_relationships[parent];
+			childLinks.parent = parent;
+			childLinks.nextSibling = parentLinks.firstChild;
+			if (parentLinks.firstChild != Entity()) {
+				m_relationships[parentLinks.firstChild].prevSibling = child;
+			}
+			parentLinks.firstChild = child;
+			++parentLinks.childCount;
+			m_hierarchyDirty = true;
+		}
+
+		void RemoveParent(Entity child) {
+			auto childIter = m_relationships.find(child);
+			if (childIter == m_relationships.end() || childIter->second.parent == Entity()) return;
+
+			Relationship& childLinks = childIter->second;
+			Entity parent = childLinks.parent;
+			detachFromParent(childLinks);
+			eraseIfUnlinked(child);
+			eraseIfUnlinked(parent);
+			m_hierarchyDirty = true;
+		}
+
+		Entity GetParent(Entity e) const noexcept {
+			auto iter = m_relationships.find(e);
+			return iter != m_relationships.end() ? iter->second.parent : Entity();
+		}
+
+		std::size_t ChildCount(Entity e) const noexcept {
+			auto iter = m_relationships.find(e);
+			return iter != m_relationships.end() ? iter->second.childCount : 0;
+		}
+
+		template <typename TFunc>
+		void ForChildren(Entity e, TFunc&& func) const {
+			auto iter = m_relationships.find(e);
+			if (iter == m_relationships.end()) return;
+
+			Entity child = iter->second.firstChild;
+			while (child != Entity()) {
+				Entity next = m_relationships.at(child).nextSibling;
+				func(child);
+				child = next;
+			}
+		}
+
+		bool IsDescendantOf(Entity e, Entity ancestor) const noexcept {
+			for (Entity parent = GetParent(e); parent != Entity(); parent = GetParent(parent)) {
+				if (parent == ancestor) return true;
+			}
+			return false;
+		}
+
+		// Every entity that has a parent or children, breadth-first from the
+		// roots. Rebuilt lazily after hierarchy changes and Refresh().
+		const std::vector<HierarchyNode, Allocator<HierarchyNode>>& HierarchyOrder() {
+			if (m_hierarchyDirty) {
+				rebuildHierarchyOrder();
+			}
+			return m_hierarchyOrder;
+		}
+
+		template <typename TFunc>
+		void ForHierarchy(TFunc&& func) {
+			for (const HierarchyNode& node : HierarchyOrder()) {
+				func(node);
+			}
+		}
+
+		// Reports reserved and used memory of every internal container
+		TMemoryStats<Settings> MemoryStats() const noexcept {
+			TMemoryStats<Settings> stats;
+
+			ComponentList::ForTypes([this, &stats](auto t) {
+				using ComponentType = TYPE_OF(t);
+				const auto& pool = std::get<Settings::template ComponentId<ComponentType>()>(m_componentPools);
+				const auto& table = std::get<Settings::template ComponentId<ComponentType>()>(m_componentIndexDatabase);
+				const auto& owners = std::get<Settings::template ComponentId<ComponentType>()>(m_componentOwnerDatabase);
+				const std::size_t nodeBytes = pool.page_bytes() / COMPONENT_POOL_SIZE;
+
+				ComponentMemoryStats& component = stats.components[Settings::template ComponentId<ComponentType>()];
+				component.live = pool.size();
+				component.slots = pool.page_count() * COMPONENT_POOL_SIZE;
+				component.reservedBytes = pool.page_count() * pool.page_bytes();
+				component.usedBytes = pool.size() * nodeBytes;
+				component.indexTableBytes = HashTableBytes(table) + owners.capacity() * sizeof(Entity);
+			});
+
+			stats.entityCount = m_nextSize;
+			stats.entityCapacity = m_entities.capacity();
+			stats.entitySlotBytes = m_entities.capacity() * sizeof(EntityData);
+			stats.entitySlotUsedBytes = m_nextSize * sizeof(EntityData);
+			stats.entityIndexTableBytes = HashTableBytes(m_entityIndexTable);
+			stats.tagColumnBytes = m_tagColumns.Bytes();
+			Settings::EventList::ForTypes([this, &stats](auto t) {
+				stats.eventQueueBytes += this->template GetEventQueue<TYPE_OF(t)>().Bytes();
+			});
+			stats.frameArenaBytes = m_frameArena.BytesReserved();
+			Settings::SharedList::ForTypes([this, &stats](auto t) {
+				stats.sharedBytes += this->template GetSharedStore<TYPE_OF(t)>().Bytes();
+			});
+			return stats;
+		}
+
+		// Makes room for `count` more entities, e.g. before a bulk load
+		void Reserve(std::size_t count) {
+			if (m_nextSize + count > m_entities.size()) {
+				growEntityCapacity(m_nextSize + count);
+			}
+			m_entityIndexTable.reserve(m_entityIndexTable.size() + count);
+		}
+
+		template <typename ComponentType>
+		void ReserveComponents(std::size_t count) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			table.reserve(table.size() + count);
+		}
+
+		// Releases unused component pool pages, entity slots and hash buckets
+		void ShrinkToFit() {
+			ComponentList::ForTypes([this](auto t) {
+				using ComponentType = TYPE_OF(t);
+				getComponentPool<ComponentType>().shrink_to_fit();
+				getComponentIndexTable<ComponentType>().rehash(0);
+
+				ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+				owners.resize(std::min(owners.size(), getComponentPool<ComponentType>().capacity()));
+				owners.shrink_to_fit();
+			});
+
+			m_entities.resize(m_nextSize);
+			m_entities.shrink_to_fit();
+			m_entityIndexTable.rehash(0);
+			m_relationships.rehash(0);
+			m_hierarchyOrder.shrink_to_fit();
+		}
+
+		Profiler& GetProfiler() noexcept {
+			return m_profiler;
+		}
+
+		const Profiler& GetProfiler() const noexcept {
+			return m_profiler;
+		}
+
+		template <typename TSignature>
+		bool MatchesSignature(EntityIndex index) const noexcept {
+			static_assert(Settings::template IsSignature<TSignature>(), "");
+
+			const auto& entityBitset(getEntityData(index).signature);
+			const auto& signatureBitset(m_signatureBitsets.template GetSignatureBitset<TSignature>());
+
+			return (entityBitset & signatureBitset) == signatureBitset;
+		}
+
+		template <typename TSignature>
+		bool MatchesSignature(Entity e) const noexcept {
+			return MatchesSignature<TSignature>(getEntityIndex(e));
+		}
+
+		template <typename TFunc>
+		void ForEntities(TFunc&& func) {
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				func(i);
+			}
+		}
+
+		template <typename TSignature, typename TFunc>
+		void ForEntitiesMatching(TFunc&& func) {
+			static_assert(Settings::template IsSignature<TSignature>(), "");
+
+			auto queryScope(m_profiler.template ScopeQuery<TSignature>("ForEntitiesMatching", m_size));
+
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				if (MatchesSignature<TSignature>(i)) {
+					queryScope.Match();
+					expandSignatureCall<TSignature>(i, func);
+				}
+			}
+		}
+
+		// Calls func(TSpan<const EntityIndex>, TSpan<Components>...) with
+		// up to ChunkSize matching entities at a time, so kernels can be
+		// written as plain loops over arrays. Components whose slots are
+		// consecutive within one pool page for the chunk (e.g. after
+		// SortComponents with reorderEntities) are passed in place, and such
+		// runs end their chunk at the page boundary. The others are moved
+		// into frame scratch memory and moved back after the call. The
+		// components of the next chunk are looked up and prefetched before
+		// the current one is processed.
+		template <typename TSignature, std::size_t ChunkSize = 256, typename TFunc>
+		void ForChunks(TFunc&& func) {
+			static_assert(Settings::template IsSignature<TSignature>(), "");
+			static_assert(ChunkSize > 0, "");
+
+			using RequiredComponents = typename Settings::SignatureBitset::template SignatureComponents<TSignature>;
+			using Helper = typename RequiredComponents::template Rename<ChunkCallHelper>;
+
+			Helper::template call<TSignature, ChunkSize>(*this, func);
+		}
+
+	private:
+
+		void detachFromParent(Relationship& childLinks) {
+			Relationship& parentLinks = m_relationships[childLinks.parent];
+			if (childLinks.prevSibling != Entity()) {
+				m_relationships[childLinks.prevSibling].nextSibling = childLinks.nextSibling;
+			}
+			else {
+				parentLinks.firstChild = childLinks.nextSibling;
+			}
+			if (childLinks.nextSibling != Entity()) {
+				m_relationships[childLinks.nextSibling].prevSibling = childLinks.prevSibling;
+			}
+			--parentLinks.childCount;
+			childLinks.parent = childLinks.prevSibling = childLinks.nextSibling = Entity();
+		}
+
+		void eraseIfUnlinked(Entity e) {
+			auto iter = m_relationships.find(e);
+			if (iter != m_relationships.end() && iter->second.parent == Entity() && iter->second.childCount == 0) {
+				m_relationships.erase(iter);
+			}
+		}
+
+		// Drops every link of an entity that is being destroyed. Its children
+		// are dead as well (see killDescendantsOfDead) and become roots until
+		// they are destroyed in turn.
+		void unlinkRelationships(Entity e) {
+			auto iter = m_relationships.find(e);
+			if (iter == m_relationships.end()) return;
+
+			Relationship& links = iter->second;
+			Entity parent = links.parent;
+			if (parent != Entity()) {
+				detachFromParent(links);
+			}
+
+			Entity child = links.firstChild;
+			while (child != Entity()) {
+				Relationship& childLinks = m_relationships[child];
+				Entity next = childLinks.nextSibling;
+				childLinks.parent = childLinks.prevSibling = childLinks.nextSibling = Entity();
+				eraseIfUnlinked(child);
+				child = next;
+			}
+
+			m_relationships.erase(e);
+			if (parent != Entity()) {
+				eraseIfUnlinked(parent);
+			}
+		}
+
+		void killDescendantsOfDead() {
+			FrameVector<Entity> pending(GetFrameAllocator<Entity>());
+			for (const auto& entry : m_relationships) {
+				if (entry.second.childCount > 0 && !IsAlive(entry.first)) {
+					pending.push_back(entry.first);
+				}
+			}
+
+			while (!pending.empty()) {
+				Entity e = pending.back();
+				pending.pop_back();
+				ForChildren(e, [this, &pending](Entity child) {
+					if (IsAlive(child)) {
+						Kill(child);
+					}
+					if (ChildCount(child) > 0) {
+						pending.push_back(child);
+					}
+				});
+			}
+		}
+
+		void rebuildHierarchyOrder() {
+			m_hierarchyOrder.clear();
+			for (const auto& entry : m_relationships) {
+				if (entry.second.parent == Entity()) {
+					m_hierarchyOrder.push_back(HierarchyNode{ entry.first, getEntityIndex(entry.first), HierarchyNode::NoParent, 0 });
+				}
+			}
+
+			for (std::size_t i = 0; i < m_hierarchyOrder.size(); ++i) {
+				Entity e = m_hierarchyOrder[i].entity;
+				std::size_t depth = m_hierarchyOrder[i].depth + 1;
+				ForChildren(e, [this, i, depth](Entity child) {
+					m_hierarchyOrder.push_back(HierarchyNode{ child, getEntityIndex(child), i, depth });
+				});
+			}
+			m_hierarchyDirty = false;
+		}
+
+		template <typename TTuple, typename TElement, std::size_t... Is>
+		static TTuple makeRepeated(MemoryResource* resource, std::index_sequence<Is...>) {
+			using ElementAllocator = typename TElement::allocator_type;
+			return TTuple((void(Is), TElement(MakeAllocator<ElementAllocator>(resource)))...);
+		}
+
+		template <typename ComponentType>
+		void setComponentOwner(ComponentIndex index, Entity e) {
+			ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+			if (index >= owners.size()) {
+				owners.resize(getComponentPool<ComponentType>().capacity());
+			}
+			owners[index] = e;
+		}
+
+		// Moves the component of `e` to slot `target`, swapping with the
+		// component already there, if any
+		template <typename ComponentType>
+		void moveComponent(Entity e, ComponentIndex target) {
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+
+			ComponentIndex& current = table.find(e)->second;
+			if (current == target) return;
+
+			pool.reserve_index(target);
+			if (target >= owners.size()) {
+				owners.resize(pool.capacity());
+			}
+
+			Entity occupant = owners[target];
+			if (occupant != Entity()) {
+				pool.swap(int(current), int(target));
+				table.find(occupant)->second = current;
+				owners[current] = occupant;
+			}
+			else {
+				pool.relocate(int(current), int(target));
+				owners[current] = Entity();
+			}
+			owners[target] = e;
+			current = target;
+		}
+
+		template <typename TGroup>
+		bool hasGroupComponents(const EntityData& entity) const noexcept {
+			bool all = true;
+			GroupComponents<TGroup>::ForTypes([&entity, &all](auto t) {
+				all = all && entity.signature[Settings::template ComponentBit<TYPE_OF(t)>()];
+			});
+			return all;
+		}
+
+		template <typename TGroup>
+		void enterGroup(Entity e) {
+			std::size_t& size = m_groupSizes[Settings::template GroupId<TGroup>()];
+			GroupComponents<TGroup>::ForTypes([this, e, size](auto t) {
+				this->template moveComponent<TYPE_OF(t)>(e, size);
+			});
+			++size;
+		}
+
+		// Swaps the member with the last one and shrinks the group
+		template <typename TGroup>
+		void leaveGroup(Entity e) {
+			std::size_t& size = m_groupSizes[Settings::template GroupId<TGroup>()];
+			--size;
+			GroupComponents<TGroup>::ForTypes([this, e, size](auto t) {
+				this->template moveComponent<TYPE_OF(t)>(e, size);
+			});
+		}
+
+		template <typename ComponentType>
+		void joinGroups(Entity e) {
+			OwningGroups<ComponentType>::ForTypes([this, e](auto t) {
+				using Group = TYPE_OF(t);
+				if (this->template hasGroupComponents<Group>(this->getEntityData(e))) {
+					this->template enterGroup<Group>(e);
+				}
+			});
+		}
+
+		// Called before ComponentType is removed from `e`; `index` follows
+		// the component if it moves
+		template <typename ComponentType>
+		void leaveGroups(Entity e, ComponentIndex& index) {
+			OwningGroups<ComponentType>::ForTypes([this, e, &index](auto t) {
+				using Group = TYPE_OF(t);
+				if (index < this->template GroupSize<Group>()) {
+					this->template leaveGroup<Group>(e);
+					index = this->template getComponentIndexTable<ComponentType>().find(e)->second;
+				}
+			});
+		}
+
+		// Regroups every matching entity in entity order, e.g. after the
+		// storage of a grouped component was sorted
+		template <typename TGroup>
+		void rebuildGroup() {
+			m_groupSizes[Settings::template GroupId<TGroup>()] = 0;
+			for (EntityIndex i = 0; i < m_nextSize; ++i) {
+				const EntityData& entity = m_entities[i];
+				if (entity.id != Entity() && hasGroupComponents<TGroup>(entity)) {
+					enterGroup<TGroup>(entity.id);
+				}
+			}
+		}
+
+		template <typename... Ts>
+		struct GroupCallHelper {
+			template <typename TFunc>
+			static void call(ThisType& system, std::size_t size, TFunc&& func) {
+				using First = typename Refl::TypeList<Ts...>::template Get<0>;
+				const ComponentOwnerTable& owners = system.template getComponentOwnerTable<First>();
+				for (std::size_t first = 0; first < size; first += COMPONENT_POOL_SIZE) {
+					const std::size_t page = first / COMPONENT_POOL_SIZE;
+					const std::size_t count = std::min(COMPONENT_POOL_SIZE, size - first);
+					std::tuple<Ts*...> pages{ system.template getComponentPool<Ts>().page_data(page)... };
+					for (std::size_t i = 0; i < count; ++i) {
+						func(owners[first + i], std::get<Ts*>(pages)[i]...);
+					}
+				}
+			}
+		};
+
+		template <typename ComponentType>
+		bool defragment(std::size_t& budget) {
+			// Grouped storage is kept in group order instead
+			if (OwningGroups<ComponentType>::Size > 0) return true;
+
+			Pool<ComponentType>& pool = getComponentPool<ComponentType>();
+			DefragCursor& cursor = m_defragCursors[Settings::template ComponentId<ComponentType>()];
+
+			for (; cursor.entity < m_nextSize; ++cursor.entity) {
+				const EntityData& entity = m_entities[cursor.entity];
+				if (!entity.signature[Settings::template ComponentBit<ComponentType>()]) continue;
+				if (budget == 0) return false;
+				--budget;
+
+				// Pages released by ShrinkToFit() leave holes in the index range
+				while (cursor.slot < pool.capacity() && !pool.is_backed(cursor.slot)) {
+					++cursor.slot;
+				}
+				if (cursor.slot >= pool.capacity()) break;
+				// Churn since the pass began; dense storage must stay packed
+				if (Settings::template IsDense<ComponentType>() && cursor.slot >= pool.size()) break;
+
+				moveComponent<ComponentType>(entity.id, cursor.slot++);
+			}
+
+			cursor = DefragCursor();
+			return true;
+		}
+
+		// Moves the refreshed entities owning ComponentType to the front of
+		// the entity array, in the storage order of their components
+		template <typename ComponentType>
+		void reorderEntitiesByComponent() {
+			const ComponentOwnerTable& owners = getComponentOwnerTable<ComponentType>();
+
+			FrameVector<EntityData> reordered = MakeFrameVector<EntityData>();
+			reordered.reserve(m_size);
+			for (Entity owner : owners) {
+				if (owner == Entity()) continue;
+				EntityIndex index = getEntityIndex(owner);
+				if (index < m_size) {
+					reordered.push_back(m_entities[index]);
+				}
+			}
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				if (!HasComponent<ComponentType>(i)) {
+					reordered.push_back(m_entities[i]);
+				}
+			}
+
+			for (EntityIndex i = 0; i < m_size; ++i) {
+				m_entities[i] = reordered[i];
+				if (m_entities[i].id != Entity()) {
+					m_entityIndexTable[m_entities[i].id] = i;
+				}
+				for (std::size_t tag = 0; tag < Settings::TagCount; ++tag) {
+					m_tagColumns.Set(tag, i, m_entities[i].signature[Settings::ComponentCount + tag]);
+				}
+			}
+			if (!m_relationships.empty()) {
+				m_hierarchyDirty = true;
+			}
+		}
+
+		template <typename TagType>
+		void setTagRange(EntityIndex first, EntityIndex last, bool value) noexcept {
+			static_assert(Settings::template IsTag<TagType>(), "");
+			assert(first <= last && last <= m_nextSize);
+
+			m_tagColumns.Fill(Settings::template TagId<TagType>(), first, last, value);
+			for (EntityIndex i = first; i < last; ++i) {
+				m_entities[i].signature[Settings::template TagBit<TagType>()] = value;
+			}
+		}
+
+		template <typename... TagTypes>
+		static std::array<std::size_t, sizeof...(TagTypes)> tagIds() noexcept {
+			return { { Settings::template TagId<TagTypes>()... } };
+		}
+
+		template <typename... Ts>
+		struct EventQueueTupleBuilder {
+			static EventQueueTuple Build(MemoryResource* resource, MemoryResource* overflow) {
+				(void)resource;
+				(void)overflow;
+				return EventQueueTuple(EventQueue<Ts>(MakeAllocator<Allocator<Ts>>(resource), 64, overflow)...);
+			}
+		};
+
+		template <typename... Ts>
+		struct SharedStoreTupleBuilder {
+			static SharedStoreTuple Build(MemoryResource* resource) {
+				(void)resource;
+				return SharedStoreTuple(SharedStore<Ts>(MakeAllocator<Allocator<Ts>>(resource))...);
+			}
+		};
+
+		void releaseShared(EntityData& entity) {
+			Settings::SharedList::ForTypes([this, &entity](auto t) {
+				std::uint32_t& handle = entity.shared[Settings::template SharedId<TYPE_OF(t)>()];
+				if (handle != 0) {
+					this->template GetSharedStore<TYPE_OF(t)>().Release(handle);
+					handle = 0;
+				}
+			});
+		}
+
+		template <typename... Ts>
+		struct PoolTupleBuilder {
+			static ComponentPoolTuple Build(MemoryResource* resource) {
+				return ComponentPoolTuple(Pool<Ts>(MakeAllocator<Allocator<Ts>>(resource))...);
+			}
+		};
+
+		template <typename TSignature, typename TFunc>
+		void expandSignatureCall(EntityIndex index, TFunc&& func) {
+			static_assert(Settings::template IsSignature<TSignature>(), "");
+
+			using RequiredComponents = typename Settings::SignatureBitset::template SignatureComponents<TSignature>;
+			using Helper = typename RequiredComponents::template Rename<ExpandCallHelper>;
+
+			Helper::call(*this, index, func);
+		}
+
+		template <typename... Ts>
+		struct ExpandCallHelper {
+			template <typename TFunc>
+			static void call(ThisType& entitySystem, EntityIndex index, TFunc&& func) {
+				Entity entity = entitySystem.getEntityData(index).id;
+				func(index, entitySystem.GetComponent<Ts>(entity)...);
+			}
+		};
+
+		template <typename... Ts>
+		struct ChunkCallHelper {
+			template <std::size_t ChunkSize>
+			struct Chunk {
+				std::size_t size{ 0 };
+				std::array<EntityIndex, ChunkSize> indices;
+				std::tuple<std::array<Ts*, ChunkSize>...> components;
+
+				// Indexed by component id: whether the slots of the chunk so
+				// far are consecutive within one pool page, and the last slot
+				std::array<bool, Settings::ComponentCount> direct;
+				std::array<ComponentIndex, Settings::ComponentCount> last;
+			};
+
+			template <typename TSignature, std::size_t ChunkSize, typename TFunc>
+			static void call(ThisType& entitySystem, TFunc&& func) {
+				auto queryScope(entitySystem.m_profiler.template ScopeQuery<TSignature>("ForChunks", entitySystem.m_size));
+
+				FrameVector<Chunk<ChunkSize>> chunks(2, Chunk<ChunkSize>(), entitySystem.template GetFrameAllocator<Chunk<ChunkSize>>());
+				std::tuple<Ts*...> scratch{ static_cast<Ts*>(nullptr)... };
+				EntityIndex cursor = 0;
+
+				auto fill = [&](Chunk<ChunkSize>& chunk) {
+					chunk.size = 0;
+					chunk.direct.fill(true);
+					for (; cursor < entitySystem.m_size && chunk.size < ChunkSize; ++cursor) {
+						if (!entitySystem.template MatchesSignature<TSignature>(cursor)) continue;
+
+						Entity entity = entitySystem.getEntityData(cursor).id;
+						std::array<ComponentIndex, Settings::ComponentCount> slots{};
+						(void)std::initializer_list<int>{ (
+							entitySystem.template getComponentIndex<Ts>(entity, slots[Settings::template ComponentId<Ts>()]),
+							0)... };
+
+						// A run that is in place so far ends at the page boundary,
+						// so the next chunk can be in place as well
+						if (chunk.size > 0 && allDirect(chunk) && crossesPage(slots)) break;
+
+						queryScope.Match();
+						(void)std::initializer_list<int>{ (
+							append<Ts>(entitySystem, chunk, slots[Settings::template ComponentId<Ts>()]),
+							0)... };
+						chunk.indices[chunk.size] = cursor;
+						++chunk.size;
+					}
+				};
+
+				std::size_t current = 0;
+				fill(chunks[current]);
+				while (chunks[current].size > 0) {
+					fill(chunks[current ^ 1]);
+					process(entitySystem, chunks[current], scratch, func);
+					current ^= 1;
+				}
+			}
+
+			template <typename T, std::size_t ChunkSize>
+			static void append(ThisType& entitySystem, Chunk<ChunkSize>& chunk, ComponentIndex slot) {
+				const std::size_t id = Settings::template ComponentId<T>();
+				if (chunk.size > 0 && (slot != chunk.last[id] + 1 || slot % Pool<T>::page_size() == 0)) {
+					chunk.direct[id] = false;
+				}
+				chunk.last[id] = slot;
+
+				// Taken from the page array, so that consecutive slots of a page
+				// can be handed out in place as one span
+				T*& component = std::get<std::array<T*, ChunkSize>>(chunk.components)[chunk.size];
+				component = entitySystem.template getComponentPool<T>().page_data(slot / Pool<T>::page_size()) + slot % Pool<T>::page_size();
+				Prefetch(component);
+			}
+
+			template <std::size_t ChunkSize>
+			static bool allDirect(const Chunk<ChunkSize>& chunk) noexcept {
+				bool direct = true;
+				(void)std::initializer_list<int>{ (direct = direct && chunk.direct[Settings::template ComponentId<Ts>()], 0)... };
+				return direct;
+			}
+
+			static bool crossesPage(const std::array<ComponentIndex, Settings::ComponentCount>& slots) noexcept {
+				bool crosses = false;
+				(void)std::initializer_list<int>{ (
+					crosses = crosses || slots[Settings::template ComponentId<Ts>()] % Pool<Ts>::page_size() == 0,
+					0)... };
+				return crosses;
+			}
+
+			template <std::size_t ChunkSize, typename TFunc>
+			static void process(ThisType& entitySystem, Chunk<ChunkSize>& chunk, std::tuple<Ts*...>& scratch, TFunc&& func) {
+				(void)std::initializer_list<int>{ (
+					chunk.direct[Settings::template ComponentId<Ts>()] ? 0 : (gather(entitySystem, std::get<std::array<Ts*, ChunkSize>>(chunk.components), std::get<Ts*>(scratch), chunk.size), 0),
+					0)... };
+
+				func(TSpan<const EntityIndex>(chunk.indices.data(), chunk.size),
+					TSpan<Ts>(chunk.direct[Settings::template ComponentId<Ts>()] ? std::get<std::array<Ts*, ChunkSize>>(chunk.components)[0] : std::get<Ts*>(scratch), chunk.size)...);
+
+				(void)std::initializer_list<int>{ (
+					chunk.direct[Settings::template ComponentId<Ts>()] ? 0 : (scatter(std::get<std::array<Ts*, ChunkSize>>(chunk.components), std::get<Ts*>(scratch), chunk.size), 0),
+					0)... };
+			}
+
+			// Components are moved into frame scratch memory, obtained on the
+			// first chunk that needs it, and moved back after the call
+			template <typename T, std::size_t ChunkSize>
+			static void gather(ThisType& entitySystem, const std::array<T*, ChunkSize>& pointers, T*& buffer, std::size_t size) {
+				if (!buffer) {
+					buffer = entitySystem.template GetFrameAllocator<T>().allocate(ChunkSize);
+				}
+				for (std::size_t i = 0; i < size; ++i) {
+					new(&buffer[i]) T(std::move(*pointers[i]));
+				}
+			}
+
+			template <typename T, std::size_t ChunkSize>
+			static void scatter(const std::array<T*, ChunkSize>& pointers, T* buffer, std::size_t size) {
+				for (std::size_t i = 0; i < size; ++i) {
+					*pointers[i] = std::move(buffer[i]);
+					buffer[i].~T();
+				}
+			}
+		};
+
+		template <typename ComponentType>
+		bool getComponentIndex(Entity e, ComponentIndex& index) {
+			static_assert(Settings::template IsComponent<ComponentType>(), "");
+
+			ComponentIndexTable& table = getComponentIndexTable<ComponentType>();
+			typename ComponentIndexTable::iterator indexResult = table.find(e);
+			if (indexResult != table.end()) {
+				index = indexResult->second;
+				return true;
+			}
+			return false;
+		}
+
+		template <typename ComponentType>
+		Pool<ComponentType>& getComponentPool() {
+			return std::get<ComponentList::template IndexOf<ComponentType>()>(m_componentPools);
+		}
+
+		template<typename ComponentType>
+		ComponentIndexTable& getComponentIndexTable() {
+			return std::get<ComponentList::template IndexOf<ComponentType>()>(m_componentIndexDatabase);
+		}
+
+		template<typename ComponentType>
+		ComponentOwnerTable& getComponentOwnerTable() {
+			return std::get<ComponentList::template IndexOf<ComponentType>()>(m_componentOwnerDatabase);
+		}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include "Span.h"
+#include "MemoryResource.h"
+
+namespace ecs {
+	// Double-buffered queue of one event type. Events emitted during a frame
+	// become readable after the next Swap(), which TEntitySystem::Refresh()
+	// performs, and stay readable until the Swap() after that.
+	//
+	// Emit() may be called from several threads at once: a writer claims a
+	// slot with an atomic increment and fills it in place. Slots beyond the
+	// preallocated capacity go to a mutex guarded overflow buffer, and Swap()
+	// grows the capacity to the peak so later frames stay lock-free. Swap()
+	// must not run concurrently with Emit().
+	//
+	// The overflow buffer allocates from its own resource rather than
+	// TAllocator, since overflow happens on emitting threads. Queues that
+	// share a resource which is not thread safe, e.g. a world arena, must be
+	// given the same LockedResource over it.
+
+	template <typename TEvent, typename TAllocator = std::allocator<TEvent>>
+	class TEventQueue {
+	public:
+		using Event = TEvent;
+
+		explicit TEventQueue(const TAllocator& allocator = TAllocator(), std::size_t capacity = 64, MemoryResource* overflow = nullptr) :
+			m_write(capacity, TEvent(), allocator), m_read(capacity, TEvent(), allocator),
+			m_overflow(TResourceAllocator<TEvent>(overflow ? overflow : GetDefaultResource())) {}
+
+		// Only used while building an entity system, never concurrently
+		TEventQueue(TEventQueue&& other) :
+			m_write(std::move(other.m_write)), m_read(std::move(other.m_read)), m_overflow(std::move(other.m_overflow)),
+			m_writeCount{ other.m_writeCount.load() }, m_readCount{ other.m_readCount } {}
+
+		TEventQueue(const TEventQueue&) = delete;
+		TEventQueue& operator=(const TEventQueue&) = delete;
+
+		template <typename TArg>
+		void Emit(TArg&& event) {
+			std::size_t slot = m_writeCount.fetch_add(1, std::memory_order_relaxed);
+			if (slot < m_write.size()) {
+				m_write[slot] = std::forward<TArg>(event);
+			}
+			else {
+				std::lock_guard<std::mutex> lock(m_overflowMutex);
+				m_overflow.push_back(std::forward<TArg>(event));
+			}
+		}
+
+		// Events emitted before the last Swap(). Overflowed events follow
+		// the in-place ones, so order is by slot claim only within each part.
+		TSpan<const TEvent> Read() const noexcept {
+			return TSpan<const TEvent>(m_read.data(), m_readCount);
+		}
+
+		// Number of events emitted since the last Swap()
+		std::size_t Pending() const noexcept {
+			return m_writeCount.load(std::memory_order_relaxed);
+		}
+
+		std::size_t Capacity() const noexcept {
+			return m_write.size();
+		}
+
+		void Reserve(std::size_t capacity) {
+			if (capacity > m_write.size()) m_write.resize(capacity);
+			if (capacity > m_read.size()) m_read.resize(capacity);
+		}
+
+		void Swap() {
+			std::size_t count = std::min(m_writeCount.load(std::memory_order_acquire), m_write.size());
+			if (!m_overflow.empty()) {
+				m_write.resize(count + m_overflow.size());
+				std::move(m_overflow.begin(), m_overflow.end(), m_write.begin() + count);
+				count += m_overflow.size();
+				m_overflow.clear();
+			}
+
+			m_write.swap(m_read);
+			m_readCount = count;
+			m_writeCount.store(0, std::memory_order_release);
+			if (m_write.size() < m_read.size()) {
+				m_write.resize(m_read.size());
+			}
+		}
+
+		// Drops both the pending and the readable events
+		void Clear() {
+			m_overflow.clear();
+			m_writeCount.store(0, std::memory_order_release);
+			m_readCount = 0;
+		}
+
+		std::size_t Bytes() const noexcept {
+			return (m_write.capacity() + m_read.capacity() + m_overflow.capacity()) * sizeof(TEvent);
+		}
+
+	private:
+		std::vector<TEvent, TAllocator> m_write;
+		std::vector<TEvent, TAllocator> m_read;
+		std::vector<TEvent, TResourceAllocator<TEvent>> m_overflow;
+		std::mutex m_overflowMutex;
+
+		std::atomic<std::size_t> m_writeCount{ 0 };
+		std::size_t m_readCount{ 0 };
+	};
+}
\ No newline at end of file
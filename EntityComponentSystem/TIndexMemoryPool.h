@@ -1,103 +1,350 @@
-#pragma once
-
-#include <mutex>
-#include <array>
-#include <cassert>
-#include <utility>
-
-namespace ecs {
-	template<typename TObject, size_t PoolSize>
-	class TIndexMemoryPool {
-	public:
-		TIndexMemoryPool() {
-
-			init_pool_();
-		}
-
-		TIndexMemoryPool(const TIndexMemoryPool& other) :
-			pool_{ other.pool_ } {
-
-			init_pool_();
-		}
-
-		TIndexMemoryPool(TIndexMemoryPool&& other) :
-			pool_{ std::move(other.pool_) },
-			first_avail_{ other.first_avail_ } {
-
-			other.first_avail_ = nullptr;
-		}
-
-		virtual ~TIndexMemoryPool() {}
-
-		TIndexMemoryPool& operator=(const TIndexMemoryPool& other) {
-			if (this != &other) {
-				std::lock(this->mutex_, other.mutex_);
-				std::lock_guard<std::mutex> lhs_lock(this->mutex_, std::adopt_lock);
-				std::lock_guard<std::mutex> rhs_lock(other.mutex_, std::adopt_lock);
-				this->pool_ = other.pool_;
-				init_pool_();
-			}
-			return *this;
-		}
-
-		TIndexMemoryPool& operator=(TIndexMemoryPool&& other) {
-			if (this != &other) {
-				pool_ = std::move(other.pool_);
-				first_avail_ = other.first_avail_;
-				other.first_avail_ = nullptr;
-			}
-			return *this;
-		}
-
-		TObject& operator[](unsigned int i) {
-			return pool_[i].obj;
-		}
-
-		int create() {
-			return create<>();
-		}
-
-		template<class... Args>
-		int create(Args&&... args) {
-			std::lock_guard<std::mutex> lock(mutex_);
-			if (first_avail_) {
-				int index = first_avail_ - pool_.data();
-				TObject* obj = reinterpret_cast<TObject*>(first_avail_);
-				first_avail_ = first_avail_->next;
-				new(obj) TObject(std::forward<Args>(args)...);
-				return index;
-			}
-			return -1;
-		}
-
-		void deallocate(int i) {
-			std::lock_guard<std::mutex> lock(mutex_);
-			if (i >= 0 && i < (int)pool_.size()) {
-				TObject* obj = &pool_[i].obj;
-				obj->~TObject();
-				PoolNode* node = reinterpret_cast<PoolNode*>(obj);
-				node->next = first_avail_;
-				first_avail_ = node;
-			}
-		}
-
-	private:
-		union PoolNode {
-			TObject obj;
-			PoolNode* next;
-			PoolNode() {}
-			~PoolNode() {}
-		};
-		std::array<PoolNode, PoolSize> pool_;
-		PoolNode* first_avail_;
-		std::mutex mutex_;
-
-		void init_pool_() {
-			first_avail_ = &pool_[0];
-			for (size_t i = 0; i < PoolSize - 1; ++i) {
-				pool_[i].next = &pool_[i + 1];
-			}
-			pool_[PoolSize - 1].next = nullptr;
-		}
-	};
+#pragma once
+
+#include <mutex>
+#include <array>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <utility>
+#include <type_traits>
+
+namespace ecs {
+	// Index-addressed object pool. Storage grows in fixed-size pages so indices
+	// stay stable and references are never invalidated by growth. Pages whose
+	// slots are all free can be handed back with shrink_to_fit(). Pages and
+	// bookkeeping are obtained from TAllocator. Free slots form a doubly
+	// linked list, so any one of them can be claimed by relocate().
+	template<typename TObject, size_t PageSize, typename TAllocator = std::allocator<TObject>>
+	class TIndexMemoryPool {
+	public:
+		explicit TIndexMemoryPool(const TAllocator& allocator = TAllocator()) :
+			allocator_{ allocator },
+			pages_{ PagePtrAllocator(allocator) },
+			page_live_{ SizeAllocator(allocator) },
+			first_avail_{ -1 } {}
+
+		// Slots are addressed by index from outside the pool, so a copy
+		// would have to reproduce every live slot at the same index.
+		// Pools are moved, never copied.
+		TIndexMemoryPool(const TIndexMemoryPool&) = delete;
+		TIndexMemoryPool& operator=(const TIndexMemoryPool&) = delete;
+
+		TIndexMemoryPool(TIndexMemoryPool&& other) :
+			allocator_{ other.allocator_ },
+			pages_{ std::move(other.pages_) },
+			page_live_{ std::move(other.page_live_) },
+			first_avail_{ other.first_avail_ },
+			size_{ other.size_ } {
+
+			other.first_avail_ = -1;
+			other.size_ = 0;
+		}
+
+		virtual ~TIndexMemoryPool() {
+			destroy_live_();
+			release_pages_();
+		}
+
+		TIndexMemoryPool& operator=(TIndexMemoryPool&& other) {
+			if (this != &other) {
+				destroy_live_();
+				release_pages_();
+				allocator_ = other.allocator_;
+				pages_ = std::move(other.pages_);
+				page_live_ = std::move(other.page_live_);
+				first_avail_ = other.first_avail_;
+				size_ = other.size_;
+				other.first_avail_ = -1;
+				other.size_ = 0;
+			}
+			return *this;
+		}
+
+		TObject& operator[](unsigned int i) {
+			return node_(i).obj;
+		}
+
+		int create() {
+			return create<>();
+		}
+
+		template<class... Args>
+		int create(Args&&... args) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (first_avail_ < 0) {
+				grow_();
+			}
+			int index = first_avail_;
+			PoolNode& node = node_(index);
+			unlink_free_(index);
+			new(&node.obj) TObject(std::forward<Args>(args)...);
+			++page_live_[index / PageSize];
+			++size_;
+			return index;
+		}
+
+		void deallocate(int i) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (i >= 0 && is_backed_(i)) {
+				PoolNode& node = node_(i);
+				node.obj.~TObject();
+				push_free_(i);
+				--page_live_[i / PageSize];
+				--size_;
+			}
+		}
+
+		// Exchanges the objects at two live indices
+		void swap(int a, int b) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			using std::swap;
+			swap(node_(a).obj, node_(b).obj);
+		}
+
+		// Moves the live object at `from` into the free index `to`, leaving
+		// `from` free
+		void relocate(int from, int to) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			unlink_free_(to);
+			TObject& obj = node_(from).obj;
+			new(&node_(to).obj) TObject(std::move(obj));
+			obj.~TObject();
+			push_free_(from);
+			--page_live_[from / PageSize];
+			++page_live_[to / PageSize];
+		}
+
+		// Objects of page `p` as a contiguous array. Only meaningful for the
+		// part of the page whose slots are all live.
+		TObject* page_data(size_t p) {
+			static_assert(sizeof(PoolNode) == sizeof(TObject), "");
+			return &(*pages_[p])[0].obj;
+		}
+
+		// Backs the page holding index `i` if it is not backed yet. Its
+		// slots join the free list.
+		void reserve_index(size_t i) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			const size_t p = i / PageSize;
+			while (pages_.size() <= p) {
+				pages_.push_back(nullptr);
+				page_live_.push_back(0);
+			}
+			if (!pages_[p]) {
+				back_page_(p);
+			}
+		}
+
+		// Whether index `i` lies on a page backed by memory
+		bool is_backed(size_t i) const {
+			return is_backed_(i);
+		}
+
+		// Number of live objects
+		size_t size() const {
+			return size_;
+		}
+
+		// Highest index that can currently be addressed, plus one
+		size_t capacity() const {
+			return pages_.size() * PageSize;
+		}
+
+		// Number of pages currently backed by memory
+		size_t page_count() const {
+			size_t count = 0;
+			for (const auto& page : pages_) {
+				if (page) ++count;
+			}
+			return count;
+		}
+
+		static constexpr size_t page_size() {
+			return PageSize;
+		}
+
+		static constexpr size_t page_bytes() {
+			return sizeof(Page);
+		}
+
+		// Relocates the live objects so that the object at index order[k]
+		// ends up at index k. Every index not in `order` must be free; all
+		// indices from order.size() on are free afterwards. The objects are
+		// staged in memory from the allocator of `order`.
+		template <typename TIndices>
+		void compact(const TIndices& order) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			assert(order.size() == size_);
+
+			using StageAllocator = typename std::allocator_traits<typename TIndices::allocator_type>::template rebind_alloc<TObject>;
+			std::vector<TObject, StageAllocator> moved{ StageAllocator(order.get_allocator()) };
+			moved.reserve(order.size());
+			for (auto index : order) {
+				TObject& obj = node_(index).obj;
+				moved.push_back(std::move(obj));
+				obj.~TObject();
+			}
+
+			while (capacity() < order.size()) {
+				grow_();
+			}
+			for (size_t p = 0; p < pages_.size(); ++p) {
+				if (!pages_[p]) {
+					pages_[p] = new(std::allocator_traits<PageAllocator>::allocate(allocator_, 1)) Page();
+				}
+				page_live_[p] = 0;
+			}
+
+			for (size_t i = 0; i < moved.size(); ++i) {
+				new(&node_(i).obj) TObject(std::move(moved[i]));
+				++page_live_[i / PageSize];
+			}
+
+			first_avail_ = -1;
+			for (size_t i = capacity(); i-- > moved.size();) {
+				push_free_((int)i);
+			}
+		}
+
+		// Releases every page that holds no live object. Indices of live
+		// objects are unaffected.
+		void shrink_to_fit() {
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			// Unlink the slots of empty pages from the free list before
+			// the pages go away, keeping the order of the remaining slots
+			for (int i = first_avail_; i >= 0;) {
+				int next = node_(i).link.next;
+				if (page_live_[i / PageSize] == 0) {
+					unlink_free_(i);
+				}
+				i = next;
+			}
+
+			for (size_t p = 0; p < pages_.size(); ++p) {
+				if (page_live_[p] == 0 && pages_[p]) {
+					free_page_(pages_[p]);
+					pages_[p] = nullptr;
+				}
+			}
+
+			while (!pages_.empty() && !pages_.back()) {
+				pages_.pop_back();
+				page_live_.pop_back();
+			}
+		}
+
+	private:
+		struct FreeLink {
+			int next;
+			int prev;
+		};
+
+		union PoolNode {
+			TObject obj;
+			FreeLink link;
+			PoolNode() {}
+			~PoolNode() {}
+		};
+		using Page = std::array<PoolNode, PageSize>;
+
+		using PageAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<Page>;
+		using PagePtrAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<Page*>;
+		using SizeAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<size_t>;
+		using FlagAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<bool>;
+
+		PageAllocator allocator_;
+		std::vector<Page*, PagePtrAllocator> pages_;
+		std::vector<size_t, SizeAllocator> page_live_;
+		int first_avail_;
+		size_t size_{ 0 };
+		mutable std::mutex mutex_;
+
+		PoolNode& node_(size_t i) {
+			assert(is_backed_(i));
+			return (*pages_[i / PageSize])[i % PageSize];
+		}
+
+		bool is_backed_(size_t i) const {
+			return i < capacity() && pages_[i / PageSize];
+		}
+
+		void free_page_(Page* page) {
+			page->~Page();
+			std::allocator_traits<PageAllocator>::deallocate(allocator_, page, 1);
+		}
+
+		// Runs the destructor of every live object. Slots do not record
+		// whether they are live, so the free list is walked to find out;
+		// this only happens when the pool goes away.
+		void destroy_live_() {
+			if (std::is_trivially_destructible<TObject>::value || size_ == 0) return;
+
+			std::vector<bool, FlagAllocator> free(capacity(), false, FlagAllocator(allocator_));
+			for (int i = first_avail_; i >= 0; i = node_(i).link.next) {
+				free[i] = true;
+			}
+			for (size_t i = 0; i < capacity(); ++i) {
+				if (is_backed_(i) && !free[i]) {
+					node_(i).obj.~TObject();
+				}
+			}
+			size_ = 0;
+		}
+
+		void release_pages_() {
+			for (Page* page : pages_) {
+				if (page) free_page_(page);
+			}
+		}
+
+		void push_free_(int i) {
+			FreeLink& link = node_(i).link;
+			link.prev = -1;
+			link.next = first_avail_;
+			if (first_avail_ >= 0) {
+				node_(first_avail_).link.prev = i;
+			}
+			first_avail_ = i;
+		}
+
+		void unlink_free_(int i) {
+			FreeLink& link = node_(i).link;
+			if (link.prev >= 0) {
+				node_(link.prev).link.next = link.next;
+			}
+			else {
+				first_avail_ = link.next;
+			}
+			if (link.next >= 0) {
+				node_(link.next).link.prev = link.prev;
+			}
+		}
+
+		void grow_() {
+			size_t p = 0;
+			while (p < pages_.size() && pages_[p]) ++p;
+			if (p == pages_.size()) {
+				pages_.push_back(nullptr);
+				page_live_.push_back(0);
+			}
+			back_page_(p);
+		}
+
+		void back_page_(size_t p) {
+			int base = (int)(p * PageSize);
+			pages_[p] = new(std::allocator_traits<PageAllocator>::allocate(allocator_, 1)) Page();
+			Page& page = *pages_[p];
+			for (size_t i = 0; i < PageSize; ++i) {
+				page[i].link.next = base + (int)i + 1;
+				page[i].link.prev = base + (int)i - 1;
+			}
+			page[0].link.prev = -1;
+			page[PageSize - 1].link.next = first_avail_;
+			if (first_avail_ >= 0) {
+				node_(first_avail_).link.prev = base + (int)PageSize - 1;
+			}
+			first_avail_ = base;
+		}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "json/json.h"
+
+namespace ecs {
+	struct QueryStats {
+		std::size_t calls{ 0 };
+		std::size_t scanned{ 0 };
+		std::size_t matched{ 0 };
+		double ns{ 0 };
+
+		double MatchRatio() const noexcept {
+			return scanned ? double(matched) / double(scanned) : 0.0;
+		}
+	};
+
+	struct StructuralChangeStats {
+		std::size_t created{ 0 };
+		std::size_t killed{ 0 };
+		std::size_t destroyed{ 0 };
+		std::size_t componentsAdded{ 0 };
+		std::size_t componentsRemoved{ 0 };
+	};
+
+	template <typename TSettings>
+	struct TFrameStats {
+		// A single timed region inside the frame, kept for trace export
+		struct Event {
+			const char* query;
+			std::size_t signature;
+			bool refresh;
+			double startUs;
+			double durationUs;
+			std::size_t scanned;
+			std::size_t matched;
+		};
+
+		std::size_t frame{ 0 };
+		std::array<QueryStats, TSettings::SignatureCount> queries;
+		StructuralChangeStats changes;
+		double refreshNs{ 0 };
+		std::vector<Event> events;
+	};
+
+	// Records per-signature iteration statistics and structural changes for
+	// each frame of a TEntitySystem. A frame ends when Refresh() returns.
+	// Selected with Options::EnableProfiling; otherwise every hook is empty.
+
+	template <typename TSettings, bool Enabled = TSettings::ProfilingEnabled>
+	class TProfiler {
+	public:
+		using Settings = TSettings;
+		using FrameStats = TFrameStats<Settings>;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+		using Event = typename FrameStats::Event;
+
+		Clock::time_point m_epoch{ Clock::now() };
+		FrameStats m_current;
+		std::deque<FrameStats> m_frames;
+		std::size_t m_frameHistory{ 300 };
+
+		double sinceEpochUs(Clock::time_point t) const noexcept {
+			return std::chrono::duration<double, std::micro>(t - m_epoch).count();
+		}
+
+		void endQuery(const char* query, std::size_t signature, Clock::time_point start, std::size_t scanned, std::size_t matched) {
+			Clock::time_point end = Clock::now();
+			QueryStats& stats = m_current.queries[signature];
+			++stats.calls;
+			stats.scanned += scanned;
+			stats.matched += matched;
+			stats.ns += std::chrono::duration<double, std::nano>(end - start).count();
+
+			double startUs = sinceEpochUs(start);
+			m_current.events.push_back(Event{ query, signature, false, startUs, sinceEpochUs(end) - startUs, scanned, matched });
+		}
+
+		void endFrame(Clock::time_point start) {
+			Clock::time_point end = Clock::now();
+			m_current.refreshNs = std::chrono::duration<double, std::nano>(end - start).count();
+
+			double startUs = sinceEpochUs(start);
+			m_current.events.push_back(Event{ "Refresh", 0, true, startUs, sinceEpochUs(end) - startUs, 0, 0 });
+
+			std::size_t next = m_current.frame + 1;
+			m_frames.push_back(std::move(m_current));
+			while (m_frames.size() > m_frameHistory) {
+				m_frames.pop_front();
+			}
+			m_current = FrameStats();
+			m_current.frame = next;
+		}
+
+	public:
+		class QueryScope {
+		private:
+			TProfiler* m_profiler;
+			const char* m_query;
+			std::size_t m_signature;
+			std::size_t m_scanned;
+			std::size_t m_matched{ 0 };
+			Clock::time_point m_start{ Clock::now() };
+
+		public:
+			QueryScope(TProfiler& profiler, const char* query, std::size_t signature, std::size_t scanned) noexcept :
+				m_profiler{ &profiler }, m_query{ query }, m_signature{ signature }, m_scanned{ scanned } {}
+
+			QueryScope(QueryScope&& other) noexcept :
+				m_profiler{ other.m_profiler }, m_query{ other.m_query }, m_signature{ other.m_signature }, m_scanned{ other.m_scanned },
+				m_matched{ other.m_matched }, m_start{ other.m_start } {
+				other.m_profiler = nullptr;
+			}
+
+			~QueryScope() {
+				if (m_profiler) {
+					m_profiler->endQuery(m_query, m_signature, m_start, m_scanned, m_matched);
+				}
+			}
+
+			void Match() noexcept { ++m_matched; }
+		};
+
+		class RefreshScope {
+		private:
+			TProfiler* m_profiler;
+			Clock::time_point m_start{ Clock::now() };
+
+		public:
+			explicit RefreshScope(TProfiler& profiler) noexcept : m_profiler{ &profiler } {}
+
+			RefreshScope(RefreshScope&& other) noexcept :
+				m_profiler{ other.m_profiler }, m_start{ other.m_start } {
+				other.m_profiler = nullptr;
+			}
+
+			~RefreshScope() {
+				if (m_profiler) {
+					m_profiler->endFrame(m_start);
+				}
+			}
+		};
+
+		// `query` names the kind of iteration in traces and must outlive the
+		// profiler, e.g. a string literal
+		template <typename TSignature>
+		QueryScope ScopeQuery(const char* query, std::size_t scanned) noexcept {
+			return QueryScope(*this, query, Settings::template SignatureId<TSignature>(), scanned);
+		}
+
+		RefreshScope ScopeRefresh() noexcept {
+			return RefreshScope(*this);
+		}
+
+		void OnCreate() noexcept { ++m_current.changes.created; }
+		void OnKill() noexcept { ++m_current.changes.killed; }
+		void OnDestroy() noexcept { ++m_current.changes.destroyed; }
+		void OnAddComponent() noexcept { ++m_current.changes.componentsAdded; }
+		void OnRemoveComponent() noexcept { ++m_current.changes.componentsRemoved; }
+
+		// Statistics of the frame in progress
+		const FrameStats& GetCurrentFrame() const noexcept {
+			return m_current;
+		}
+
+		// Completed frames, oldest first
+		const std::deque<FrameStats>& GetFrames() const noexcept {
+			return m_frames;
+		}
+
+		void SetFrameHistory(std::size_t frames) {
+			m_frameHistory = frames;
+			while (m_frames.size() > m_frameHistory) {
+				m_frames.pop_front();
+			}
+		}
+
+		void Clear() {
+			m_frames.clear();
+			m_current = FrameStats();
+		}
+
+		// Writes the recorded frames in Chrome's trace event format, loadable
+		// in chrome://tracing or Perfetto.
+		void WriteChromeTrace(std::ostream& out) const {
+			Json::Value root;
+			Json::Value& events = root["traceEvents"];
+			events = Json::Value(Json::arrayValue);
+
+			for (const FrameStats& frame : m_frames) {
+				for (const Event& event : frame.events) {
+					Json::Value entry;
+					entry["ph"] = "X";
+					entry["pid"] = 0;
+					entry["tid"] = 0;
+					entry["ts"] = event.startUs;
+					entry["dur"] = event.durationUs;
+					if (event.refresh) {
+						entry["name"] = "Refresh";
+						entry["args"]["frame"] = Json::UInt64(frame.frame);
+					}
+					else {
+						entry["name"] = event.query + ("[S" + std::to_string(event.signature) + "]");
+						entry["args"]["scanned"] = Json::UInt64(event.scanned);
+						entry["args"]["matched"] = Json::UInt64(event.matched);
+						entry["args"]["matchRatio"] = event.scanned ? double(event.matched) / double(event.scanned) : 0.0;
+					}
+					events.append(entry);
+				}
+
+				if (!frame.events.empty()) {
+					const Event& last = frame.events.back();
+					Json::Value counter;
+					counter["ph"] = "C";
+					counter["pid"] = 0;
+					counter["name"] = "StructuralChanges";
+					counter["ts"] = last.startUs + last.durationUs;
+					counter["args"]["created"] = Json::UInt64(frame.changes.created);
+					counter["args"]["killed"] = Json::UInt64(frame.changes.killed);
+					counter["args"]["destroyed"] = Json::UInt64(frame.changes.destroyed);
+					counter["args"]["componentsAdded"] = Json::UInt64(frame.changes.componentsAdded);
+					counter["args"]["componentsRemoved"] = Json::UInt64(frame.changes.componentsRemoved);
+					events.append(counter);
+				}
+			}
+
+			Json::FastWriter writer;
+			out << writer.write(root);
+		}
+	};
+
+	template <typename TSettings>
+	class TProfiler<TSettings, false> {
+	public:
+		using Settings = TSettings;
+		using FrameStats = TFrameStats<Settings>;
+
+		struct QueryScope {
+			void Match() noexcept {}
+		};
+
+		struct RefreshScope {};
+
+		template <typename TSignature>
+		QueryScope ScopeQuery(const char*, std::size_t) noexcept { return QueryScope(); }
+
+		RefreshScope ScopeRefresh() noexcept { return RefreshScope(); }
+
+		void OnCreate() noexcept {}
+		void OnKill() noexcept {}
+		void OnDestroy() noexcept {}
+		void OnAddComponent() noexcept {}
+		void OnRemoveComponent() noexcept {}
+
+		// Nothing is recorded: the current frame stays empty and no frames
+		// are ever completed
+		const FrameStats& GetCurrentFrame() const noexcept {
+			static const FrameStats empty;
+			return empty;
+		}
+
+		const std::deque<FrameStats>& GetFrames() const noexcept {
+			static const std::deque<FrameStats> empty;
+			return empty;
+		}
+
+		void SetFrameHistory(std::size_t) noexcept {}
+		void Clear() noexcept {}
+
+		void WriteChromeTrace(std::ostream& out) const {
+			out << "{\"traceEvents\":[]}\n";
+		}
+	};
+}
\ No newline at end of file
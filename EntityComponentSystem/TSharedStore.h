@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include "MemoryStats.h"
+
+namespace ecs {
+	// Deduplicated storage of one shared component type. Equal values are
+	// stored once and reference counted; entities refer to them through a
+	// 32-bit handle. Values are found by std::hash<T> and compared with
+	// operator==, and are immutable while stored.
+
+	template <typename T, typename TAllocator = std::allocator<T>>
+	class TSharedStore {
+		static_assert(std::is_default_constructible<T>::value, "TSharedStore: released values are reset to T() to free their resources");
+
+	public:
+		using Handle = std::uint32_t;
+		static constexpr Handle None = 0;
+
+		explicit TSharedStore(const TAllocator& allocator = TAllocator()) :
+			m_entries(EntryAllocator(allocator)), m_free(HandleAllocator(allocator)), m_buckets(BucketAllocator(allocator)) {}
+
+		// Handle of the stored value equal to `value`, storing it first if
+		// there is none. Each call takes one reference.
+		Handle Acquire(const T& value) {
+			const std::size_t hash = std::hash<T>()(value);
+			auto bucket = m_buckets.find(hash);
+			if (bucket != m_buckets.end()) {
+				for (Handle h = bucket->second; h != None; h = entry(h).next) {
+					if (entry(h).value == value) {
+						++entry(h).refs;
+						return h;
+					}
+				}
+			}
+
+			Handle h;
+			if (!m_free.empty()) {
+				h = m_free.back();
+				m_free.pop_back();
+				entry(h).value = value;
+			}
+			else {
+				m_entries.push_back(Entry{ value, 0, 0, None });
+				h = Handle(m_entries.size());
+			}
+
+			Entry& stored = entry(h);
+			stored.hash = hash;
+			stored.refs = 1;
+			stored.next = bucket != m_buckets.end() ? bucket->second : None;
+			m_buckets[hash] = h;
+			++m_count;
+			return h;
+		}
+
+		void Retain(Handle h) noexcept {
+			++entry(h).refs;
+		}
+
+		// Drops one reference; the value is destroyed with the last one
+		void Release(Handle h) {
+			Entry& released = entry(h);
+			assert(released.refs > 0);
+			if (--released.refs > 0) return;
+
+			auto bucket = m_buckets.find(released.hash);
+			if (bucket->second == h) {
+				if (released.next == None) {
+					m_buckets.erase(bucket);
+				}
+				else {
+					bucket->second = released.next;
+				}
+			}
+			else {
+				Handle prev = bucket->second;
+				while (entry(prev).next != h) {
+					prev = entry(prev).next;
+				}
+				entry(prev).next = released.next;
+			}
+
+			released.value = T();
+			m_free.push_back(h);
+			--m_count;
+		}
+
+		const T& Get(Handle h) const noexcept {
+			return entry(h).value;
+		}
+
+		std::size_t RefCount(Handle h) const noexcept {
+			return entry(h).refs;
+		}
+
+		// Number of distinct values stored
+		std::size_t Count() const noexcept {
+			return m_count;
+		}
+
+		// Every handle is below this bound
+		std::size_t HandleLimit() const noexcept {
+			return m_entries.size() + 1;
+		}
+
+		void Clear() {
+			m_entries.clear();
+			m_free.clear();
+			m_buckets.clear();
+			m_count = 0;
+		}
+
+		std::size_t Bytes() const noexcept {
+			return m_entries.capacity() * sizeof(Entry) + m_free.capacity() * sizeof(Handle) + HashTableBytes(m_buckets);
+		}
+
+	private:
+		struct Entry {
+			T value;
+			std::size_t hash;
+			std::size_t refs;
+			Handle next;
+		};
+
+		using EntryAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<Entry>;
+		using HandleAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<Handle>;
+		using BucketAllocator = typename std::allocator_traits<TAllocator>::template rebind_alloc<std::pair<const std::size_t, Handle>>;
+
+		std::vector<Entry, EntryAllocator> m_entries;
+		std::vector<Handle, HandleAllocator> m_free;
+		std::unordered_map<std::size_t, Handle, std::hash<std::size_t>, std::equal_to<std::size_t>, BucketAllocator> m_buckets;
+		std::size_t m_count{ 0 };
+
+		Entry& entry(Handle h) noexcept {
+			assert(h != None && h <= m_entries.size());
+			return m_entries[h - 1];
+		}
+
+		const Entry& entry(Handle h) const noexcept {
+			assert(h != None && h <= m_entries.size());
+			return m_entries[h - 1];
+		}
+	};
+}
\ No newline at end of file
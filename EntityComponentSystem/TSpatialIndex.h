@@ -0,0 +1,368 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include "Entity.h"
+#include "MemoryResource.h"
+#include "TEntitySystem.h"
+
+namespace ecs {
+	// Reads the coordinates of a position component. Specialize for
+	// components that do not expose public x, y and z members.
+	template <typename TPosition>
+	struct SpatialPosition {
+		static float X(const TPosition& p) noexcept { return p.x; }
+		static float Y(const TPosition& p) noexcept { return p.y; }
+		static float Z(const TPosition& p) noexcept { return p.z; }
+	};
+
+	// Uniform hash grid over every entity owning a TPosition component.
+	// Update() detects moved, new and removed entities by scanning every
+	// entity and comparing against the positions seen last time; when more
+	// than the rebuild threshold of entries changed it rebuilds every cell in
+	// one batch, otherwise it moves only the changed entries. When callers
+	// know what changed, MarkMoved() and UpdateMarked() touch only those
+	// entities. Queries look up entity indices as they are called, so they
+	// stay valid across Refresh(); destroyed entities that were never marked
+	// are skipped until the next Update() drops them. Cells and lookup
+	// tables are obtained from the Settings allocator policy.
+
+	template <typename TSettings, typename TPosition>
+	class TSpatialHashGrid {
+	public:
+		using Settings = TSettings;
+		using EntitySystem = TEntitySystem<Settings>;
+		using Entity = typename EntitySystem::Entity;
+		using Position = SpatialPosition<TPosition>;
+
+		explicit TSpatialHashGrid(float cellSize, MemoryResource* resource = nullptr) :
+			m_cellSize{ cellSize },
+			m_inverseCellSize{ 1.0f / cellSize },
+			m_resource{ resource },
+			m_cells{ MakeAllocator<typename CellTable::allocator_type>(resource) },
+			m_locations{ MakeAllocator<typename LocationTable::allocator_type>(resource) },
+			m_pending{ MakeAllocator<Allocator<Entry>>(resource) },
+			m_scratch{ MakeAllocator<Allocator<Entry>>(resource) },
+			m_marked{ MakeAllocator<Allocator<Entity>>(resource) } {
+			static_assert(Settings::template IsComponent<TPosition>(), "");
+			assert(cellSize > 0);
+		}
+
+		// Fraction of indexed entities that may change before Update()
+		// switches from incremental moves to a full rebuild
+		void SetRebuildThreshold(double threshold) noexcept {
+			m_rebuildThreshold = threshold;
+		}
+
+		bool LastUpdateRebuilt() const noexcept {
+			return m_lastRebuilt;
+		}
+
+		std::size_t Size() const noexcept {
+			return m_locations.size();
+		}
+
+		// Number of occupied cells
+		std::size_t CellCount() const noexcept {
+			return m_cells.size();
+		}
+
+		void Update(EntitySystem& entitySystem) {
+			m_system = &entitySystem;
+			m_marked.clear();
+			++m_stamp;
+			m_pending.clear();
+
+			// Entries that stay in their cell are refreshed in place and
+			// stamped; entries that moved to another cell are left unstamped
+			// and queued together with new entities.
+			std::size_t seen = 0, kept = 0, moved = 0, crossed = 0;
+			entitySystem.ForEntities([&](EntityIndex index) {
+				if (!entitySystem.template HasComponent<TPosition>(index)) return;
+
+				Entity e = entitySystem.GetEntity(index);
+				Entry entry = makeEntry(entitySystem, e);
+				++seen;
+
+				auto found = m_locations.find(e);
+				if (found == m_locations.end()) {
+					m_pending.push_back(entry);
+					return;
+				}
+
+				Entry& current = m_cells.at(found->second.cell)[found->second.slot];
+				if (current.x != entry.x || current.y != entry.y || current.z != entry.z) {
+					++moved;
+					if (found->second.cell != cellOf(entry)) {
+						++crossed;
+						m_pending.push_back(entry);
+						return;
+					}
+				}
+				current = entry;
+				++kept;
+			});
+
+			std::size_t stale = m_locations.size() - kept;
+			std::size_t added = m_pending.size() - crossed;
+			std::size_t removed = stale - crossed;
+			std::size_t changes = moved + added + removed;
+			m_lastRebuilt = changes > m_rebuildThreshold * double(std::max<std::size_t>(seen, 1));
+
+			if (m_lastRebuilt) {
+				rebuild();
+			}
+			else {
+				if (stale > 0) {
+					removeStale();
+				}
+				for (const Entry& entry : m_pending) {
+					insert(entry);
+				}
+			}
+		}
+
+		// Records that an entity was added, moved, lost its TPosition or was
+		// destroyed since the last update
+		void MarkMoved(Entity e) {
+			m_marked.push_back(e);
+		}
+
+		// Applies the entities recorded by MarkMoved(), leaving every other
+		// entry untouched
+		void UpdateMarked(EntitySystem& entitySystem) {
+			m_system = &entitySystem;
+			m_lastRebuilt = false;
+
+			for (Entity e : m_marked) {
+				auto found = m_locations.find(e);
+				if (!entitySystem.IsHandleValid(e) || !entitySystem.template HasComponent<TPosition>(e)) {
+					if (found != m_locations.end()) {
+						erase(found);
+					}
+					continue;
+				}
+
+				Entry entry = makeEntry(entitySystem, e);
+				if (found == m_locations.end()) {
+					insert(entry);
+				}
+				else if (found->second.cell == cellOf(entry)) {
+					m_cells.at(found->second.cell)[found->second.slot] = entry;
+				}
+				else {
+					erase(found);
+					insert(entry);
+				}
+			}
+			m_marked.clear();
+		}
+
+		// Calls func(Entity, EntityIndex) for every entity inside the box
+		template <typename TFunc>
+		void QueryAABB(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, TFunc&& func) const {
+			forCells(minX, minY, minZ, maxX, maxY, maxZ, [&](const Entry& entry) {
+				if (entry.x >= minX && entry.x <= maxX &&
+					entry.y >= minY && entry.y <= maxY &&
+					entry.z >= minZ && entry.z <= maxZ) {
+					report(entry, func);
+				}
+			});
+		}
+
+		template <typename TFunc>
+		void QueryRadius(float x, float y, float z, float radius, TFunc&& func) const {
+			const float radiusSq = radius * radius;
+			forCells(x - radius, y - radius, z - radius, x + radius, y + radius, z + radius, [&](const Entry& entry) {
+				float dx = entry.x - x, dy = entry.y - y, dz = entry.z - z;
+				if (dx * dx + dy * dy + dz * dz <= radiusSq) {
+					report(entry, func);
+				}
+			});
+		}
+
+		void QueryAABB(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, std::vector<EntityIndex>& out) const {
+			QueryAABB(minX, minY, minZ, maxX, maxY, maxZ, [&out](Entity, EntityIndex index) { out.push_back(index); });
+		}
+
+		void QueryRadius(float x, float y, float z, float radius, std::vector<EntityIndex>& out) const {
+			QueryRadius(x, y, z, radius, [&out](Entity, EntityIndex index) { out.push_back(index); });
+		}
+
+		void Clear() {
+			m_cells.clear();
+			m_locations.clear();
+			m_marked.clear();
+		}
+
+	private:
+		using CellKey = std::uint64_t;
+
+		template <typename T>
+		using Allocator = typename Settings::template Allocator<T>;
+
+		struct Entry {
+			Entity entity;
+			float x, y, z;
+			std::size_t stamp;
+		};
+
+		struct Location {
+			CellKey cell;
+			std::size_t slot;
+		};
+
+		using Cell = std::vector<Entry, Allocator<Entry>>;
+		using CellTable = std::unordered_map<CellKey, Cell, std::hash<CellKey>, std::equal_to<CellKey>, Allocator<std::pair<const CellKey, Cell>>>;
+		using LocationTable = std::unordered_map<Entity, Location, std::hash<Entity>, std::equal_to<Entity>, Allocator<std::pair<const Entity, Location>>>;
+
+		// Cell coordinates are clamped to this magnitude, so the span of any
+		// box fits an int32 and cell keys stay well defined
+		static constexpr std::int32_t MaxCellCoord = std::int32_t(1) << 29;
+
+		float m_cellSize;
+		float m_inverseCellSize;
+		MemoryResource* m_resource;
+		double m_rebuildThreshold{ 0.25 };
+		bool m_lastRebuilt{ false };
+		std::size_t m_stamp{ 0 };
+		const EntitySystem* m_system{ nullptr };
+
+		CellTable m_cells;
+		LocationTable m_locations;
+		Cell m_pending;
+		Cell m_scratch;
+		std::vector<Entity, Allocator<Entity>> m_marked;
+
+		Entry makeEntry(EntitySystem& entitySystem, Entity e) const {
+			const TPosition& position = entitySystem.template GetComponent<TPosition>(e);
+			return Entry{ e, Position::X(position), Position::Y(position), Position::Z(position), m_stamp };
+		}
+
+		template <typename TFunc>
+		void report(const Entry& entry, TFunc& func) const {
+			if (m_system->IsHandleValid(entry.entity)) {
+				func(entry.entity, m_system->getEntityIndex(entry.entity));
+			}
+		}
+
+		// NaN maps to cell 0; infinite and far-away coordinates to the
+		// outermost cells
+		std::int32_t cellCoord(float v) const noexcept {
+			const float limit = float(MaxCellCoord);
+			float c = std::floor(v * m_inverseCellSize);
+			if (c != c) return 0;
+			return static_cast<std::int32_t>(std::max(-limit, std::min(c, limit)));
+		}
+
+		// 21 bits per axis, wrapping; collisions only cost extra distance checks
+		static CellKey cellKey(std::int32_t cx, std::int32_t cy, std::int32_t cz) noexcept {
+			const CellKey mask = (CellKey(1) << 21) - 1;
+			return (CellKey(cx) & mask) | ((CellKey(cy) & mask) << 21) | ((CellKey(cz) & mask) << 42);
+		}
+
+		CellKey cellOf(const Entry& entry) const noexcept {
+			return cellKey(cellCoord(entry.x), cellCoord(entry.y), cellCoord(entry.z));
+		}
+
+		void insert(const Entry& entry) {
+			CellKey key = cellOf(entry);
+			auto found = m_cells.find(key);
+			if (found == m_cells.end()) {
+				found = m_cells.emplace(key, Cell(MakeAllocator<Allocator<Entry>>(m_resource))).first;
+			}
+			Cell& cell = found->second;
+			m_locations[entry.entity] = Location{ key, cell.size() };
+			cell.push_back(entry);
+		}
+
+		// Removes the entry of a location, dropping its cell once empty
+		typename LocationTable::iterator erase(typename LocationTable::iterator iter) {
+			Location location = iter->second;
+			auto cellIter = m_cells.find(location.cell);
+			Cell& cell = cellIter->second;
+			if (location.slot + 1 != cell.size()) {
+				cell[location.slot] = cell.back();
+				m_locations[cell[location.slot].entity].slot = location.slot;
+			}
+			cell.pop_back();
+			if (cell.empty()) {
+				m_cells.erase(cellIter);
+			}
+			return m_locations.erase(iter);
+		}
+
+		void removeStale() {
+			for (auto iter = m_locations.begin(); iter != m_locations.end();) {
+				const Location& location = iter->second;
+				if (m_cells.at(location.cell)[location.slot].stamp != m_stamp) {
+					iter = erase(iter);
+				}
+				else {
+					++iter;
+				}
+			}
+		}
+
+		// Gathers every live entry, sorts by cell and refills the cells so
+		// entries of a cell are written together. The staging buffer is kept
+		// between rebuilds.
+		void rebuild() {
+			Cell& entries = m_scratch;
+			entries.clear();
+			entries.reserve(m_locations.size() + m_pending.size());
+			for (const auto& cell : m_cells) {
+				for (const Entry& entry : cell.second) {
+					if (entry.stamp == m_stamp) {
+						entries.push_back(entry);
+					}
+				}
+			}
+			entries.insert(entries.end(), m_pending.begin(), m_pending.end());
+
+			std::sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+				return cellOf(a) < cellOf(b);
+			});
+
+			m_cells.clear();
+			m_locations.clear();
+			for (const Entry& entry : entries) {
+				insert(entry);
+			}
+		}
+
+		template <typename TFunc>
+		void forCells(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, TFunc&& func) const {
+			std::int32_t x0 = cellCoord(minX), y0 = cellCoord(minY), z0 = cellCoord(minZ);
+			std::int32_t x1 = cellCoord(maxX), y1 = cellCoord(maxY), z1 = cellCoord(maxZ);
+			if (x1 < x0 || y1 < y0 || z1 < z0) return;
+
+			// A box spanning more cells than exist is cheaper to answer by
+			// visiting every occupied cell
+			double spanned = (double(x1) - x0 + 1) * (double(y1) - y0 + 1) * (double(z1) - z0 + 1);
+			if (spanned > double(m_cells.size())) {
+				for (const auto& cell : m_cells) {
+					for (const Entry& entry : cell.second) {
+						func(entry);
+					}
+				}
+				return;
+			}
+
+			for (std::int32_t cz = z0; cz <= z1; ++cz) {
+				for (std::int32_t cy = y0; cy <= y1; ++cy) {
+					for (std::int32_t cx = x0; cx <= x1; ++cx) {
+						auto found = m_cells.find(cellKey(cx, cy, cz));
+						if (found == m_cells.end()) continue;
+						for (const Entry& entry : found->second) {
+							func(entry);
+						}
+					}
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
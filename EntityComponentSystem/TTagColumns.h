@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ecs {
+	inline std::size_t PopCount(std::uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<std::size_t>(__builtin_popcountll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		return static_cast<std::size_t>(__popcnt64(word));
+#else
+		std::size_t count = 0;
+		for (; word; word &= word - 1) ++count;
+		return count;
+#endif
+	}
+
+	inline std::size_t CountTrailingZeros(std::uint64_t word) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<std::size_t>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long bit;
+		_BitScanForward64(&bit, word);
+		return bit;
+#else
+		std::size_t count = 0;
+		for (; !(word & 1); word >>= 1) ++count;
+		return count;
+#endif
+	}
+
+	// One bit column per tag, indexed by entity index. Mirrors the tag bits
+	// of the entity signatures so tag-only work can run over whole 64-bit
+	// words instead of per-entity bitsets.
+
+	template <std::size_t TagCount, typename TAllocator = std::allocator<std::uint64_t>>
+	class TTagColumns {
+	public:
+		using Word = std::uint64_t;
+		static constexpr std::size_t WordBits = 64;
+
+		explicit TTagColumns(const TAllocator& allocator = TAllocator()) : m_words(allocator) {}
+
+		// Grows every column to hold at least `bits` entries
+		void Reserve(std::size_t bits) {
+			std::size_t wordCount = (bits + WordBits - 1) / WordBits;
+			if (wordCount <= m_wordCount) return;
+
+			std::vector<Word, TAllocator> words(TagCount * wordCount, Word(0), m_words.get_allocator());
+			for (std::size_t tag = 0; tag < TagCount; ++tag) {
+				std::copy(Column(tag), Column(tag) + m_wordCount, words.data() + tag * wordCount);
+			}
+			m_words.swap(words);
+			m_wordCount = wordCount;
+		}
+
+		std::size_t WordCount() const noexcept { return m_wordCount; }
+
+		std::size_t Bytes() const noexcept { return m_words.capacity() * sizeof(Word); }
+
+		Word* Column(std::size_t tag) noexcept { return m_words.data() + tag * m_wordCount; }
+		const Word* Column(std::size_t tag) const noexcept { return m_words.data() + tag * m_wordCount; }
+
+		bool Test(std::size_t tag, std::size_t index) const noexcept {
+			return (Column(tag)[index / WordBits] >> (index % WordBits)) & 1;
+		}
+
+		void Set(std::size_t tag, std::size_t index, bool value) noexcept {
+			Word& word = Column(tag)[index / WordBits];
+			const Word bit = Word(1) << (index % WordBits);
+			word = value ? (word | bit) : (word & ~bit);
+		}
+
+		// Sets or clears [first, last) of a column, whole words at a time
+		void Fill(std::size_t tag, std::size_t first, std::size_t last, bool value) noexcept {
+			if (first >= last) return;
+			Word* column = Column(tag);
+			std::size_t firstWord = first / WordBits, lastWord = (last - 1) / WordBits;
+			for (std::size_t w = firstWord; w <= lastWord; ++w) {
+				Word mask = ~Word(0);
+				if (w == firstWord) mask &= ~Word(0) << (first % WordBits);
+				if (w == lastWord) mask &= ~Word(0) >> (WordBits - 1 - (last - 1) % WordBits);
+				column[w] = value ? (column[w] | mask) : (column[w] & ~mask);
+			}
+		}
+
+		void Swap(std::size_t a, std::size_t b) noexcept {
+			for (std::size_t tag = 0; tag < TagCount; ++tag) {
+				bool bitA = Test(tag, a), bitB = Test(tag, b);
+				Set(tag, a, bitB);
+				Set(tag, b, bitA);
+			}
+		}
+
+		void ClearIndex(std::size_t index) noexcept {
+			for (std::size_t tag = 0; tag < TagCount; ++tag) {
+				Set(tag, index, false);
+			}
+		}
+
+		void Reset() noexcept {
+			std::fill(m_words.begin(), m_words.end(), Word(0));
+		}
+
+		// Number of the first `size` entries that have every tag in `tags`
+		template <std::size_t N>
+		std::size_t Count(const std::array<std::size_t, N>& tags, std::size_t size) const noexcept {
+			std::size_t count = 0;
+			forWords(tags, size, [&count](std::size_t, Word word) { count += PopCount(word); });
+			return count;
+		}
+
+		// Calls func(index) for each of the first `size` entries that have
+		// every tag in `tags`, in index order
+		template <std::size_t N, typename TFunc>
+		void ForEach(const std::array<std::size_t, N>& tags, std::size_t size, TFunc&& func) const {
+			forWords(tags, size, [&func](std::size_t w, Word word) {
+				while (word) {
+					func(w * WordBits + CountTrailingZeros(word));
+					word &= word - 1;
+				}
+			});
+		}
+
+	private:
+		std::vector<Word, TAllocator> m_words;
+		std::size_t m_wordCount{ 0 };
+
+		template <std::size_t N, typename TFunc>
+		void forWords(const std::array<std::size_t, N>& tags, std::size_t size, TFunc&& func) const {
+			std::size_t wordCount = std::min((size + WordBits - 1) / WordBits, m_wordCount);
+			for (std::size_t w = 0; w < wordCount; ++w) {
+				Word word = ~Word(0);
+				for (std::size_t tag : tags) {
+					word &= Column(tag)[w];
+				}
+				if (w + 1 == wordCount && size % WordBits) {
+					word &= ~Word(0) >> (WordBits - size % WordBits);
+				}
+				if (word) {
+					func(w, word);
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
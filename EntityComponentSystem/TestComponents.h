@@ -0,0 +1,197 @@
+#pragma once
+
+// Components, tags, signatures and settings shared by the runtime tests,
+// the benchmarks and the stress tester
+
+#include <string>
+#include <functional>
+#include "Reflection.h"
+#include "Settings.h"
+#include "TEntitySystem.h"
+#include "ColumnarImport.h"
+
+namespace ecs {
+	namespace test {
+
+		struct PositionComponent : public Component {
+			float x;
+			float y;
+			float z;
+
+			std::string Name() const { return "positionComponent"; }
+			void Serialize(Json::Value&) const {};
+			void Deserialize(const Json::Value& root) {
+				x = root.get("x", "-1").asFloat();
+				y = root.get("y", "-1").asFloat();
+				z = root.get("z", "-1").asFloat();
+			};
+		};
+
+		struct HealthComponent : public Component {
+			float health;
+			float maxHealth;
+
+			std::string Name() const { return "healthComponent"; }
+			void Serialize(Json::Value&) const {};
+			void Deserialize(const Json::Value& root) {
+				health = root.get("health", "-1").asFloat();
+				maxHealth = root.get("maxHealth", "-1").asFloat();
+			};
+		};
+
+		struct RenderableComponent : public Component {
+			int meshId;
+
+			std::string Name() const { return "renderableComponent"; }
+			void Serialize(Json::Value&) const {};
+			void Deserialize(const Json::Value& root) {
+				meshId = root.get("meshId", "-1").asInt();
+			};
+		};
+
+		using MyComponentList = Refl::TypeList<PositionComponent, HealthComponent, RenderableComponent>;
+	}
+
+	template <>
+	struct ComponentFields<test::PositionComponent> {
+		static constexpr bool Described = true;
+		static constexpr bool Complete = true;
+		static auto Get() {
+			return std::make_tuple(
+				Field("x", &test::PositionComponent::x),
+				Field("y", &test::PositionComponent::y),
+				Field("z", &test::PositionComponent::z));
+		}
+	};
+
+	template <>
+	struct ComponentFields<test::HealthComponent> {
+		static constexpr bool Described = true;
+		static constexpr bool Complete = true;
+		static auto Get() {
+			return std::make_tuple(
+				Field("health", &test::HealthComponent::health),
+				Field("maxHealth", &test::HealthComponent::maxHealth));
+		}
+	};
+
+	template <>
+	struct ComponentFields<test::RenderableComponent> {
+		static constexpr bool Described = true;
+		static constexpr bool Complete = true;
+		static auto Get() {
+			return std::make_tuple(Field("meshId", &test::RenderableComponent::meshId));
+		}
+	};
+
+	namespace test {
+
+		struct T0 {};
+		struct T1 {};
+		struct T2 {};
+		using MyTagList = Refl::TypeList<T0, T1, T2>;
+
+		using S0 = Refl::TypeList<>;
+		using S1 = Refl::TypeList<PositionComponent, HealthComponent>;
+		using S2 = Refl::TypeList<PositionComponent, RenderableComponent, T0>;
+		using S3 = Refl::TypeList<HealthComponent, T0, RenderableComponent, T2>;
+		using MySignatureList = Refl::TypeList<S0, S1, S2, S3>;
+
+		using MySettings = Settings<MyComponentList, MyTagList, MySignatureList>;
+
+		struct ProfiledOptions : DefaultOptions {
+			static constexpr bool EnableProfiling = true;
+		};
+
+		using MyProfiledSettings = Settings<MyComponentList, MyTagList, MySignatureList, ProfiledOptions>;
+
+		struct ArenaOptions : DefaultOptions {
+			template <typename T>
+			using Allocator = TResourceAllocator<T>;
+		};
+
+		using MyArenaSettings = Settings<MyComponentList, MyTagList, MySignatureList, ArenaOptions>;
+
+		struct GameClock {
+			double time{ 0 };
+			int frame{ 0 };
+		};
+
+		struct Gravity {
+			float value{ -9.8f };
+		};
+
+		struct SingletonOptions : DefaultOptions {
+			using SingletonList = Refl::TypeList<GameClock, Gravity>;
+		};
+
+		using MySingletonSettings = Settings<MyComponentList, MyTagList, MySignatureList, SingletonOptions>;
+
+		struct DamageEvent {
+			Entity target;
+			float amount{ 0 };
+		};
+
+		struct EventOptions : DefaultOptions {
+			using EventList = Refl::TypeList<DamageEvent>;
+		};
+
+		using MyEventSettings = Settings<MyComponentList, MyTagList, MySignatureList, EventOptions>;
+
+		struct CompactOptions : DefaultOptions {
+			using EntityHandle = CompactEntity;
+		};
+
+		using MyCompactSettings = Settings<MyComponentList, MyTagList, MySignatureList, CompactOptions>;
+
+		// 12-bit slot index, small enough to run out of in a test
+		using TinyEntity = TEntity<std::uint16_t, 4>;
+
+		struct TinyHandleOptions : DefaultOptions {
+			using EntityHandle = TinyEntity;
+		};
+
+		using MyTinyHandleSettings = Settings<MyComponentList, MyTagList, MySignatureList, TinyHandleOptions>;
+
+		struct GroupOptions : DefaultOptions {
+			using GroupList = Refl::TypeList<S1>;
+		};
+
+		using MyGroupSettings = Settings<MyComponentList, MyTagList, MySignatureList, GroupOptions>;
+
+		// Shared component: one copy per distinct mesh
+		struct MeshInfo {
+			int meshId;
+			float scale;
+
+			bool operator==(const MeshInfo& other) const {
+				return meshId == other.meshId && scale == other.scale;
+			}
+		};
+	}
+}
+
+namespace std {
+	template <>
+	struct hash<ecs::test::MeshInfo> {
+		size_t operator()(const ecs::test::MeshInfo& mesh) const {
+			return hash<int>()(mesh.meshId) * 31 + hash<float>()(mesh.scale);
+		}
+	};
+}
+
+namespace ecs {
+	namespace test {
+		struct SharedOptions : DefaultOptions {
+			using SharedList = Refl::TypeList<MeshInfo>;
+		};
+
+		using MySharedSettings = Settings<MyComponentList, MyTagList, MySignatureList, SharedOptions>;
+
+		struct DenseOptions : DefaultOptions {
+			using DenseList = Refl::TypeList<HealthComponent>;
+		};
+
+		using MyDenseSettings = Settings<MyComponentList, MyTagList, MySignatureList, DenseOptions>;
+	}
+}
\ No newline at end of file
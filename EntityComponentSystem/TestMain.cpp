@@ -0,0 +1,9 @@
+// Runs the runtime tests. Asserts must stay enabled, e.g.
+//   g++ -std=c++14 -O2 -I. TestMain.cpp jsoncpp.cpp -o ecs_tests -pthread
+
+#include "ECSTests.h"
+
+int main() {
+	ecs::test::RuntimeTests();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace ecs {
+	// Fixed set of worker threads for data-parallel loading work.
+	// ParallelFor() hands out indices one at a time, so uneven items (large
+	// and small files, deep and shallow prototype trees) balance themselves.
+	// The calling thread works too; with no workers everything runs inline.
+	// ParallelFor() calls are serialized and must not be nested.
+
+	class ThreadPool {
+	public:
+		// `threads` counts the calling thread, so 1 means no workers
+		explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) {
+			for (std::size_t i = 1; i < threads; ++i) {
+				m_workers.emplace_back([this]() { workerLoop(); });
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (std::thread& worker : m_workers) {
+				worker.join();
+			}
+		}
+
+		std::size_t ThreadCount() const noexcept {
+			return m_workers.size() + 1;
+		}
+
+		// Calls func(i) for every i in [0, count) and returns once all calls
+		// are done. The first exception thrown by a call is rethrown here
+		// after the remaining calls have been skipped.
+		template <typename TFunc>
+		void ParallelFor(std::size_t count, TFunc&& func) {
+			if (count == 0) return;
+			if (m_workers.empty() || count == 1) {
+				for (std::size_t i = 0; i < count; ++i) {
+					func(i);
+				}
+				return;
+			}
+
+			std::lock_guard<std::mutex> submit(m_submitMutex);
+			Job job(count, [&func](std::size_t i) { func(i); });
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_job = &job;
+				++m_generation;
+			}
+			m_wake.notify_all();
+
+			job.Run();
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_job = nullptr;
+				m_idle.wait(lock, [this]() { return m_busy == 0; });
+			}
+			if (job.error) {
+				std::rethrow_exception(job.error);
+			}
+		}
+
+	private:
+		struct Job {
+			Job(std::size_t count, std::function<void(std::size_t)> func) : count{ count }, func{ std::move(func) } {}
+
+			std::size_t count;
+			std::function<void(std::size_t)> func;
+			std::atomic<std::size_t> next{ 0 };
+			std::atomic<bool> failed{ false };
+			std::exception_ptr error;
+			std::mutex errorMutex;
+
+			void Run() {
+				for (std::size_t i = next++; i < count && !failed; i = next++) {
+					try {
+						func(i);
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> lock(errorMutex);
+						if (!error) error = std::current_exception();
+						failed = true;
+					}
+				}
+			}
+		};
+
+		std::vector<std::thread> m_workers;
+		std::mutex m_submitMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_idle;
+		Job* m_job{ nullptr };
+		std::size_t m_generation{ 0 };
+		std::size_t m_busy{ 0 };
+		bool m_stop{ false };
+
+		void workerLoop() {
+			std::size_t seen = 0;
+			while (true) {
+				Job* job;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this, seen]() { return m_stop || (m_job && m_generation != seen); });
+					if (m_stop) return;
+					seen = m_generation;
+					job = m_job;
+					++m_busy;
+				}
+
+				job->Run();
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					--m_busy;
+				}
+				m_idle.notify_all();
+			}
+		}
+	};
+}
\ No newline at end of file